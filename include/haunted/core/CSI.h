@@ -28,8 +28,13 @@ namespace Haunted {
 			/** Parses a CSI sequence. Throws an exception if the input is invalid. */
 			CSI(const std::string &);
 
+			/** Returns the key the sequence represents. Throws an exception if it doesn't represent a known key. */
 			Key getKey() const;
 
+			/** Stores the key the sequence represents and returns true, or returns false if it doesn't represent a
+			 *  known key. */
+			bool tryGetKey(Key &) const;
+
 			operator std::pair<int, int>() const;
 
 
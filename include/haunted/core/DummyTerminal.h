@@ -8,7 +8,8 @@
 
 namespace Haunted {
 	/**
-	 * Represents a virtual terminal whose output is suppressed. Useful for unit testing.
+	 * Represents a virtual terminal whose output is suppressed. Useful for unit testing. Tests that need to examine
+	 * the output should use HeadlessTerminal instead.
 	 */
 	class DummyTerminal: public Terminal {
 		private:
@@ -28,8 +29,12 @@ namespace Haunted {
 			void redraw() override {}
 			void setRoot(UI::Control *, bool) override {}
 			void draw() override {}
-			void startInput() override {}
+			void startInput(bool = true) override {}
+			void startOutput() override {}
+			void run() override {}
 			void flush() override {}
+			void claimMargins(size_t, size_t, size_t, size_t) override {}
+			void releaseMargins() override {}
 			void hmargins(size_t, size_t) override {}
 			void hmargins() override {}
 			void vmargins(size_t, size_t) override {}
@@ -47,6 +52,13 @@ namespace Haunted {
 			void left(size_t) override {}
 			void vscroll(int) override {}
 			void clearLine() override {}
+			void clearRight() override {}
+			void clearLeft() override {}
+			void clearRect(int, int, int, int) override {}
+			void front() override {}
+			void back() override {}
+			void save() override {}
+			void restore() override {}
 			void show() override {}
 			void hide() override {}
 			operator bool() const override { return true; }
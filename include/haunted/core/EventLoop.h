@@ -0,0 +1,88 @@
+#ifndef HAUNTED_CORE_EVENTLOOP_H_
+#define HAUNTED_CORE_EVENTLOOP_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace Haunted {
+	/**
+	 * An epoll-based event loop. It watches arbitrary file descriptors (sockets, pipes, the terminal) and dispatches
+	 * timers through timerfd and signals through signalfd, so signals are handled as ordinary events on the loop's
+	 * thread instead of in signal context. Everything except post and stop has to be called from the thread running
+	 * the loop or before it starts.
+	 */
+	class EventLoop {
+		public:
+			/** Receives the epoll events (EPOLLIN, EPOLLOUT, EPOLLHUP, ...) that occurred on a file descriptor. */
+			using Callback = std::function<void(uint32_t)>;
+
+		private:
+			int epollFd = -1;
+			/** Written to by post and stop to wake the loop. */
+			int wakeFd = -1;
+
+			/** Callbacks are stored in shared pointers so that one can unwatch its own descriptor while running. */
+			std::unordered_map<int, std::shared_ptr<Callback>> callbacks;
+			/** Maps signal numbers to the signalfds that receive them. */
+			std::unordered_map<int, int> signalFds;
+			std::unordered_set<int> timerFds;
+
+			std::atomic<bool> running = false;
+
+			std::mutex postMutex;
+			std::vector<std::function<void()>> posted;
+
+			void runPosted();
+
+		public:
+			EventLoop();
+			EventLoop(const EventLoop &) = delete;
+			~EventLoop();
+
+			/** Starts watching a file descriptor for a set of epoll events. Watching a descriptor that's already being
+			 *  watched replaces its events and callback. Throws std::runtime_error if epoll rejects the descriptor. */
+			void watch(int fd, uint32_t events, Callback);
+
+			/** Stops watching a file descriptor. The descriptor isn't closed. */
+			void unwatch(int fd);
+
+			/** Calls a function after a delay and then, if the interval is nonzero, repeatedly at that interval.
+			 *  Returns an identifier that can be passed to cancelTimer. */
+			int addTimer(std::chrono::nanoseconds delay, std::chrono::nanoseconds interval, std::function<void()>);
+
+			/** Cancels a timer. One-shot timers are cancelled automatically after they fire. */
+			void cancelTimer(int);
+
+			/** Handles a signal on the loop instead of in signal context. The signal is blocked in the calling thread
+			 *  (and any threads it creates afterward); it has to be blocked in every other thread too, or it may be
+			 *  delivered to one of them instead. */
+			void watchSignal(int signal, std::function<void()>);
+
+			/** Stops handling a signal on the loop and unblocks it in the calling thread. */
+			void unwatchSignal(int signal);
+
+			/** Queues a function to be called on the loop's thread. Safe to call from any thread. */
+			void post(std::function<void()>);
+
+			/** Waits for events for up to a given number of milliseconds (or indefinitely if negative) and dispatches
+			 *  them. Returns the number of events dispatched. */
+			int runOnce(int timeout_ms = -1);
+
+			/** Dispatches events until stop is called. */
+			void run();
+
+			/** Makes run return after the events currently being dispatched. Safe to call from any thread. */
+			void stop();
+
+			bool isRunning() const { return running; }
+	};
+}
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef HAUNTED_CORE_EVENTQUEUE_H_
+#define HAUNTED_CORE_EVENTQUEUE_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+#include "haunted/core/InputDecoder.h"
+#include "haunted/core/Metrics.h"
+
+namespace Haunted {
+	/**
+	 * A bounded lock-free queue of input events between exactly one producer (the thread reading the terminal) and
+	 * exactly one consumer (the thread that dispatches input to controls). Each event is stamped when it's pushed so
+	 * the time it spends waiting can be measured. When the queue is full, the producer waits for the consumer instead
+	 * of dropping input.
+	 */
+	class EventQueue {
+		private:
+			struct Slot {
+				InputDecoder::Event event;
+				std::chrono::steady_clock::time_point queued;
+			};
+
+			std::unique_ptr<Slot[]> slots;
+			size_t mask;
+
+			/** The next position the producer will fill. Only the producer writes it. */
+			alignas(64) std::atomic<size_t> head {0};
+			/** The next position the consumer will take. Only the consumer writes it. */
+			alignas(64) std::atomic<size_t> tail {0};
+
+			/** Incremented whenever something is pushed, so the consumer can sleep until something changes. */
+			std::atomic<uint32_t> pushed {0};
+			/** Incremented whenever something is popped, so a blocked producer can sleep until there's room. */
+			std::atomic<uint32_t> popped {0};
+
+		public:
+			/** The time events spent in the queue. */
+			LatencyHistogram latency;
+			/** The most events that have been waiting at once. */
+			std::atomic<size_t> maxDepth {0};
+			/** The number of times the producer found the queue full and had to wait. */
+			std::atomic<uint64_t> stalls {0};
+
+			/** Creates a queue with room for a given number of events, rounded up to a power of two. */
+			EventQueue(size_t capacity = 1024);
+
+			EventQueue(const EventQueue &) = delete;
+
+			/** Adds an event to the queue. Returns false without doing anything if the queue is full. */
+			bool tryPush(InputDecoder::Event &&);
+
+			/** Adds an event to the queue, waiting for room if it's full. Gives up and returns false if `keep_going`
+			 *  is false while the queue is full; call wakeProducer after clearing it. */
+			bool push(InputDecoder::Event &&, const std::atomic<bool> &keep_going);
+
+			/** Removes the oldest event from the queue and records how long it waited. Returns false if the queue is
+			 *  empty. */
+			bool tryPop(InputDecoder::Event &);
+
+			/** Returns the number of events waiting. */
+			size_t depth() const;
+
+			/** Returns a value to pass to wait before checking the queue. */
+			uint32_t epoch() const { return pushed.load(std::memory_order_acquire); }
+
+			/** Blocks until something has been pushed or wake has been called since epoch returned a given value. */
+			void wait(uint32_t old_epoch) const { pushed.wait(old_epoch, std::memory_order_acquire); }
+
+			/** Wakes the consumer without pushing anything. */
+			void wake();
+
+			/** Wakes a producer waiting for room without popping anything. */
+			void wakeProducer();
+	};
+}
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef HAUNTED_CORE_HEADLESSTERMINAL_H_
+#define HAUNTED_CORE_HEADLESSTERMINAL_H_
+
+#include <chrono>
+#include <sstream>
+#include <string>
+
+#include "haunted/core/Screen.h"
+#include "haunted/core/Terminal.h"
+
+namespace Haunted {
+	/**
+	 * Represents a terminal that isn't attached to a tty. Everything written to it is interpreted by an in-memory
+	 * screen, which can be inspected or compared against golden files, and the output is measured. Useful for testing
+	 * and benchmarking drawing code.
+	 */
+	class HeadlessTerminal: public Terminal {
+		public:
+			/** Contains statistics about the output written to the terminal. */
+			struct Stats {
+				size_t frames = 0;
+				size_t bytes = 0;
+				/** The number of escape sequences, counted by their introducers. */
+				size_t sequences = 0;
+				/** The time between beginning frames and writing them. */
+				std::chrono::nanoseconds elapsed {0};
+			};
+
+		private:
+			std::istringstream input;
+			std::ostringstream output;
+			ansi::ansistream outputStream {output, output};
+
+			Screen screen;
+			Stats lastStats, totalStats;
+
+			/** The number of frames in progress and when the outermost one was begun. */
+			int frameNesting = 0;
+			std::chrono::steady_clock::time_point frameStart;
+
+			void apply() override {}
+			void reset() override {}
+
+			/** Interprets anything written to the output stream outside of a frame. */
+			void sync();
+
+			/** Adds a chunk of output to the statistics and interprets it. */
+			void consume(const std::string &, Stats &);
+
+		protected:
+			size_t writeOutput(std::string) override;
+
+		public:
+			// The streams are only bound by the base class's constructor, so passing them before they're constructed
+			// is safe.
+			HeadlessTerminal(int cols_ = 80, int rows_ = 24);
+
+			void cbreak() override {}
+			void watchSize() override {}
+			void startInput(bool = true) override {}
+			void startOutput() override {}
+			void beginFrame() override;
+			void commitFrame() override;
+
+			/** Resizes the terminal as if the window had been resized. */
+			void setSize(int cols_, int rows_);
+
+			/** Returns the screen after interpreting all output written so far. */
+			const Screen & getScreen();
+
+			/** Returns the plain text of the screen, one line per row. */
+			std::string dump();
+
+			/** Compares the plain text of the screen with the contents of a file. If `update` is true or the file
+			 *  doesn't exist, the file is overwritten with the screen's contents instead. Throws std::runtime_error if
+			 *  the file can't be read or written. */
+			bool matchesGolden(const std::string &path, bool update = false);
+
+			/** Returns statistics about the most recent frame. */
+			const Stats & getLastStats() const { return lastStats; }
+			/** Returns statistics about all output written since the terminal was created or the stats were reset. */
+			const Stats & getTotalStats() const { return totalStats; }
+			void resetStats();
+	};
+}
+
+#endif
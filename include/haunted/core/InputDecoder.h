@@ -0,0 +1,76 @@
+#ifndef HAUNTED_CORE_INPUTDECODER_H_
+#define HAUNTED_CORE_INPUTDECODER_H_
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include "haunted/core/Key.h"
+#include "haunted/core/Mouse.h"
+
+namespace Haunted {
+	/**
+	 * Turns raw terminal input into key presses and mouse reports. It's a state machine driven by a table of byte
+	 * classes, so input can be fed in chunks of any size (sequences may be split across chunks) and decoding doesn't
+	 * allocate anything beyond the output vector.
+	 */
+	class InputDecoder {
+		public:
+			/** Text pasted while bracketed paste mode is enabled, delivered all at once instead of as keys. */
+			struct Paste {
+				std::string text;
+			};
+
+			using Event = std::variant<Key, MouseReport, Paste>;
+
+		private:
+			enum class State: char {Ground, Escape, CSIStart, CSI, Paste};
+			enum class ByteClass: char {Control, Escape, Digit, Separator, Colon, Marker, Intermediate, Final, Other};
+
+			static constexpr size_t maxParams = 8;
+
+			State state = State::Ground;
+			std::array<unsigned int, maxParams> params {};
+			size_t paramCount = 0;
+			/** A private marker like '<' at the start of a CSI sequence, or 0. */
+			char marker = 0;
+			/** Set after a colon so that subparameters are ignored. */
+			bool skippingSubparam = false;
+			/** The text of a paste that hasn't ended yet. */
+			std::string pasteBuffer;
+
+			static const std::array<ByteClass, 256> classes;
+
+			/** Returns the key for a byte that isn't part of an escape sequence. */
+			static Key groundKey(char);
+
+			void beginCSI();
+			void dispatchCSI(char final_char, std::vector<Event> &);
+
+			/** Consumes pasted text up to the end of the input or the end of the paste. Returns the number of bytes
+			 *  consumed. */
+			size_t feedPaste(std::string_view, std::vector<Event> &);
+
+		public:
+			/** If true, every byte is decoded as a key by itself. */
+			bool raw = false;
+
+			/** Decodes a chunk of input and appends the events it completes to a vector. */
+			void feed(std::string_view, std::vector<Event> &);
+
+			/** Returns whether the decoder is in the middle of a sequence. */
+			bool partial() const { return state != State::Ground; }
+
+			/** Discards any partial sequence or paste. */
+			void reset() { state = State::Ground; pasteBuffer.clear(); }
+
+			/** Resolves a partial sequence after no more input has arrived for a while: a lone escape becomes the
+			 *  escape key and "^[[" becomes Alt+[. An unfinished CSI sequence is discarded. The text of an unfinished
+			 *  paste is delivered as it is, and the rest of the paste will follow in another event. */
+			void flush(std::vector<Event> &);
+	};
+}
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef HAUNTED_CORE_INPUTRECORDING_H_
+#define HAUNTED_CORE_INPUTRECORDING_H_
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <string_view>
+
+namespace Haunted {
+	/**
+	 * A single entry in an input recording: a chunk of raw bytes as it was read from the terminal, or the point at
+	 * which a partial sequence was resolved because nothing else arrived in time. Recording the resolutions along with
+	 * the bytes is what makes a replay decode exactly the same events regardless of how fast it runs.
+	 */
+	struct RecordedInput {
+		enum class Type: uint8_t {Input = 1, Flush = 2};
+
+		Type type = Type::Input;
+		/** The time since recording began. */
+		std::chrono::microseconds time {0};
+		/** The bytes read. Empty for flushes. */
+		std::string bytes;
+	};
+
+	/**
+	 * Writes raw terminal input to a file as it's read. The format is compact: after a short header, each entry is a
+	 * type byte, the microseconds since the previous entry and, for input, the length of the chunk followed by its
+	 * bytes, with both numbers encoded as LEB128 varints.
+	 */
+	class InputRecorder {
+		private:
+			std::ofstream stream;
+			std::chrono::steady_clock::time_point start;
+			/** The time of the previous entry, relative to start. */
+			std::chrono::microseconds last {0};
+
+			void writeVarint(uint64_t);
+			void writeHeader(RecordedInput::Type);
+
+		public:
+			static constexpr std::string_view magic = "HAUNTREC\x01";
+
+			/** Creates or truncates a recording file. Throws std::runtime_error if it can't be opened. */
+			InputRecorder(const std::string &path);
+			InputRecorder(const InputRecorder &) = delete;
+
+			/** Records a chunk of raw input. */
+			void input(std::string_view);
+
+			/** Records that the decoder was flushed. */
+			void flush();
+	};
+
+	/**
+	 * Reads the entries of a file written by InputRecorder.
+	 */
+	class InputPlayback {
+		private:
+			std::ifstream stream;
+			std::chrono::microseconds time {0};
+
+			/** Reads a varint. Returns false at the end of the file. */
+			bool readVarint(uint64_t &);
+
+		public:
+			/** Opens a recording. Throws std::runtime_error if it can't be opened or isn't a recording. */
+			InputPlayback(const std::string &path);
+			InputPlayback(const InputPlayback &) = delete;
+
+			/** Reads the next entry. Returns false at the end of the recording. Throws std::runtime_error if the
+			 *  recording is corrupt or truncated. */
+			bool next(RecordedInput &);
+	};
+}
+
+#endif
@@ -1,7 +1,9 @@
 #ifndef HAUNTED_CORE_KEYS_H_
 #define HAUNTED_CORE_KEYS_H_
 
+#include <array>
 #include <bitset>
+#include <cstdint>
 #include <string>
 #include <unordered_map>
 
@@ -45,7 +47,9 @@ namespace Haunted {
 	 */
 	struct Key {
 		private:
-			static std::unordered_map<KeyType, std::string> keymap;
+			static constexpr size_t nameCount = size_t(KeyType::PageDown) + 1;
+			/** Names for keys that don't print as themselves, indexed by key type. */
+			static const std::array<const char *, nameCount> names;
 
 		public:
 			KeyType type;
@@ -91,6 +95,9 @@ namespace Haunted {
 			bool hasAlt() const;
 			bool hasCtrl() const;
 
+			/** Packs the key type and modifiers into a single integer, for use as a lookup key. */
+			uint32_t pack() const { return uint32_t(int(type) + 1) << 3 | uint32_t(mods.to_ulong()); }
+
 			/** Returns false if the key is null/invalid. */
 			operator bool() const;
 
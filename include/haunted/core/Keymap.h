@@ -0,0 +1,82 @@
+#ifndef HAUNTED_CORE_KEYMAP_H_
+#define HAUNTED_CORE_KEYMAP_H_
+
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <unordered_map>
+#include <vector>
+
+#include "haunted/core/Key.h"
+
+namespace Haunted {
+	/**
+	 * A table of key bindings. Single keys and chords (sequences of keys like ^x ^s) are stored in a trie whose edges
+	 * are keyed by packed keys, so looking up a key takes constant time no matter how many bindings there are.
+	 * Bindings can be changed at any time. The keymap remembers how much of a chord has been typed so far.
+	 */
+	class Keymap {
+		public:
+			/** Called when a binding's keys have been typed, with the last key. Like InputHandler::onKey, returning
+			 *  false means the binding declined the key. */
+			using Action = std::function<bool(const Key &)>;
+
+			enum class Match {
+				/** The key isn't bound (or the binding declined it). */
+				None,
+				/** The key continues a chord that isn't finished yet. */
+				Partial,
+				/** The key completed a binding, whose action handled it. */
+				Full
+			};
+
+		private:
+			struct Node {
+				Action action;
+				std::unordered_map<uint32_t, uint32_t> next;
+			};
+
+			/** The root is the first node. Nodes of removed bindings are reused for new ones. */
+			std::vector<Node> nodes {1};
+			std::vector<uint32_t> freeNodes;
+
+			/** The node reached by the keys typed so far in an unfinished chord, or 0. */
+			uint32_t position = 0;
+
+			uint32_t addNode();
+
+			/** Returns the node a sequence of keys leads to, or 0 if there isn't one. */
+			uint32_t find(const std::vector<Key> &) const;
+
+		public:
+			/** Binds a key or a chord to an action, replacing any existing binding for it. A chord can't begin with
+			 *  another binding's keys or be a prefix of one, since one of the two would never be reached; throws
+			 *  std::invalid_argument if it would. */
+			void bind(const std::vector<Key> &, Action);
+			void bind(std::initializer_list<Key> keys, Action action) { bind(std::vector<Key>(keys), action); }
+			void bind(const Key &key, Action action) { bind(std::vector<Key> {key}, action); }
+
+			/** Removes the binding for a key or chord. Returns whether there was one. */
+			bool unbind(const std::vector<Key> &);
+			bool unbind(const Key &key) { return unbind(std::vector<Key> {key}); }
+
+			/** Returns whether a key or chord is bound. */
+			bool bound(const std::vector<Key> &keys) const { return nodes[find(keys)].action != nullptr; }
+			bool bound(const Key &key) const { return bound(std::vector<Key> {key}); }
+
+			/** Handles a key press. A key that doesn't continue an unfinished chord abandons it and is looked up as
+			 *  the start of a new one. */
+			Match feed(const Key &);
+
+			/** Returns whether a chord has been started but not finished. */
+			bool pending() const { return position != 0; }
+
+			/** Abandons an unfinished chord. */
+			void reset() { position = 0; }
+
+			/** Removes every binding. */
+			void clear();
+	};
+}
+
+#endif
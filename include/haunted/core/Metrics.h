@@ -0,0 +1,153 @@
+#ifndef HAUNTED_CORE_METRICS_H_
+#define HAUNTED_CORE_METRICS_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Haunted {
+	namespace UI {
+		class Control;
+	}
+
+	/**
+	 * Contains statistics about the output written for a single frame.
+	 */
+	struct FrameStats {
+		/** The number of bytes handed to the kernel, including the synchronized update brackets. */
+		size_t bytes = 0;
+		/** The number of write(2) calls it took to write the frame, or zero if it was handed to the output thread. */
+		size_t writes = 0;
+		/** The number of escape sequences in the frame. */
+		size_t sequences = 0;
+		/** The time between beginning the frame and writing it. Zero for output flushed outside of a frame. */
+		std::chrono::nanoseconds latency {0};
+	};
+
+	/**
+	 * Contains statistics about waiting for a mutex. Uncontended acquisitions are only counted; the clock is read only
+	 * when a thread actually has to wait.
+	 */
+	struct LockStats {
+		std::atomic<uint64_t> acquisitions {0}, contended {0};
+		std::atomic<uint64_t> waitNanos {0}, maxWaitNanos {0};
+
+		void record(std::chrono::nanoseconds wait);
+	};
+
+	/**
+	 * A fixed-size histogram of durations with eight buckets per power of two, so percentiles are accurate to within
+	 * about 12% without storing every sample. Recording is lock-free.
+	 */
+	class LatencyHistogram {
+		private:
+			static constexpr size_t bucketCount = 496;
+			std::array<std::atomic<uint32_t>, bucketCount> buckets {};
+
+			static size_t bucketFor(uint64_t nanos);
+			static uint64_t upperBound(size_t bucket);
+
+		public:
+			void record(std::chrono::nanoseconds);
+
+			/** Returns an upper bound for the duration below which a given fraction (0-1) of the samples fall. */
+			std::chrono::nanoseconds percentile(double) const;
+
+			uint64_t count() const;
+			void reset();
+	};
+
+	/**
+	 * Contains statistics about the time spent drawing a control. Times include any children the control draws.
+	 */
+	struct DrawStats {
+		std::string id;
+		uint64_t draws = 0;
+		std::chrono::nanoseconds total {0}, max {0};
+	};
+
+	/**
+	 * Collects statistics about a terminal's output and rendering: frames, bytes and escape sequences written, frame
+	 * latency, draw time per control and time spent waiting for locks. It's cheap enough to leave enabled.
+	 */
+	class Metrics {
+		private:
+			std::mutex drawMutex;
+			/** Keyed by pointer so the (expensive) ID is only computed the first time a control is drawn. */
+			std::unordered_map<const UI::Control *, DrawStats> drawStats;
+
+		public:
+			/** A copy of the metrics at one point in time. */
+			struct Snapshot {
+				uint64_t frames = 0, bytes = 0, sequences = 0;
+				uint64_t lastBytes = 0, lastSequences = 0;
+				std::chrono::nanoseconds p50 {0}, p99 {0};
+				struct Lock {
+					uint64_t acquisitions = 0, contended = 0;
+					std::chrono::nanoseconds wait {0}, maxWait {0};
+				} renderLock, outputLock, lineLock;
+				/** Sorted by total draw time, longest first. */
+				std::vector<DrawStats> draws;
+			};
+
+			/** Times a control's draw method from construction until destruction. */
+			class DrawTimer {
+				private:
+					Metrics *metrics;
+					const UI::Control *control;
+					std::chrono::steady_clock::time_point start;
+
+				public:
+					DrawTimer(Metrics *, const UI::Control *);
+					DrawTimer(const DrawTimer &) = delete;
+					~DrawTimer();
+			};
+
+			/** Whether statistics are being collected. */
+			std::atomic<bool> enabled = true;
+
+			std::atomic<uint64_t> frames {0}, bytes {0}, sequences {0};
+			std::atomic<uint64_t> lastBytes {0}, lastSequences {0};
+
+			/** The time between beginning a frame and handing its output to the kernel (or the output thread). */
+			LatencyHistogram frameLatency;
+
+			LockStats renderLock, outputLock, lineLock;
+
+			/** Records a frame. Output flushed outside of a frame has no latency and isn't added to the histogram. */
+			void recordFrame(const FrameStats &);
+			void recordDraw(const UI::Control *, std::chrono::nanoseconds);
+
+			/** Discards the statistics for a control. Called when the control is destroyed. */
+			void forget(const UI::Control *);
+
+			/** Returns an object that records the time until it's destroyed as time spent drawing a control. */
+			DrawTimer timeDraw(const UI::Control *control) { return DrawTimer(this, control); }
+
+			/** Locks a mutex, recording how long it took if another thread held it. */
+			template <typename M>
+			std::unique_lock<M> lock(M &mutex, LockStats &stats) {
+				std::unique_lock<M> out(mutex, std::try_to_lock);
+				if (!enabled)
+					return out.owns_lock()? std::move(out) : std::unique_lock<M>(mutex);
+				stats.acquisitions.fetch_add(1, std::memory_order_relaxed);
+				if (!out.owns_lock()) {
+					const auto start = std::chrono::steady_clock::now();
+					out.lock();
+					stats.record(std::chrono::steady_clock::now() - start);
+				}
+
+				return out;
+			}
+
+			Snapshot snapshot();
+			void reset();
+	};
+}
+
+#endif
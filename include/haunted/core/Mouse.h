@@ -17,6 +17,8 @@ namespace Haunted {
 			MouseButton button;
 			ModSet mods;
 			long x, y; // zero-based.
+			/** The number of scroll wheel notches a scroll report stands for after coalescing. */
+			long count = 1;
 
 			MouseReport(long type, char fchar, long x, long y);
 
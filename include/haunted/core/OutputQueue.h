@@ -0,0 +1,69 @@
+#ifndef HAUNTED_CORE_OUTPUTQUEUE_H_
+#define HAUNTED_CORE_OUTPUTQUEUE_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace Haunted {
+	/**
+	 * A bounded lock-free queue of output chunks that any number of threads can push to and a single thread pops
+	 * from. It's a ring of slots that each carry a sequence number, as in Dmitry Vyukov's bounded queue: producers
+	 * claim a position with a compare-and-swap and publish the slot by advancing its sequence number.
+	 */
+	class OutputQueue {
+		public:
+			struct Chunk {
+				std::string data;
+				/** Whether the data bypasses the back buffer, like a mode change, instead of being drawn. */
+				bool direct = false;
+				/** When the frame that produced the chunk was begun, if it was measured. */
+				std::chrono::steady_clock::time_point started {};
+			};
+
+		private:
+			struct Slot {
+				std::atomic<size_t> sequence;
+				Chunk chunk;
+			};
+
+			std::unique_ptr<Slot[]> slots;
+			size_t mask;
+
+			/** The next position producers will claim. */
+			alignas(64) std::atomic<size_t> head {0};
+			/** The next position the consumer will pop. Only the consumer touches it. */
+			alignas(64) size_t tail = 0;
+
+			/** Incremented whenever something is pushed, so the consumer can sleep until something changes. */
+			std::atomic<uint32_t> signal {0};
+
+		public:
+			/** Creates a queue with room for a given number of chunks, rounded up to a power of two. */
+			OutputQueue(size_t capacity = 256);
+
+			OutputQueue(const OutputQueue &) = delete;
+
+			/** Adds a chunk to the queue. Returns false without doing anything if the queue is full. */
+			bool tryPush(Chunk &&);
+
+			/** Adds a chunk to the queue, yielding until there's room for it. */
+			void push(Chunk &&);
+
+			/** Removes the oldest chunk from the queue. Returns false if the queue is empty. Only one thread may pop. */
+			bool tryPop(Chunk &);
+
+			/** Returns a value to pass to wait before checking the queue. */
+			uint32_t epoch() const { return signal.load(std::memory_order_acquire); }
+
+			/** Blocks until something has been pushed or wake has been called since epoch returned a given value. */
+			void wait(uint32_t old_epoch) const { signal.wait(old_epoch, std::memory_order_acquire); }
+
+			/** Wakes the consumer without pushing anything. */
+			void wake();
+	};
+}
+
+#endif
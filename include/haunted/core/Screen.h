@@ -0,0 +1,178 @@
+#ifndef HAUNTED_CORE_SCREEN_H_
+#define HAUNTED_CORE_SCREEN_H_
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Haunted {
+	/**
+	 * Represents a single character cell on the screen.
+	 */
+	struct Cell {
+		static constexpr uint8_t Bold      =  1;
+		static constexpr uint8_t Dim       =  2;
+		static constexpr uint8_t Italic    =  4;
+		static constexpr uint8_t Underline =  8;
+		static constexpr uint8_t Blink     = 16;
+		static constexpr uint8_t Inverse   = 32;
+		static constexpr uint8_t Strike    = 64;
+
+		/** The UTF-8 text displayed in the cell. The cell to the right of a doublewide character has an empty glyph. */
+		std::string glyph = " ";
+
+		/** Colors are palette indices (0-255). -1 represents the terminal's default color. */
+		int16_t foreground = -1, background = -1;
+
+		uint8_t attributes = 0;
+
+		bool operator==(const Cell &other) const {
+			return foreground == other.foreground && background == other.background &&
+				attributes == other.attributes && glyph == other.glyph;
+		}
+
+		bool operator!=(const Cell &other) const { return !(*this == other); }
+
+		/** Returns whether the cell has the same colors and attributes as another cell. */
+		bool sameStyle(const Cell &other) const {
+			return foreground == other.foreground && background == other.background && attributes == other.attributes;
+		}
+	};
+
+	/**
+	 * Represents a grid of cells along with enough terminal state to interpret the output that controls write to a
+	 * terminal: cursor movement, SGR, erasure, scrolling regions, left/right margins and origin mode. Terminals use it
+	 * as the back buffer when double buffering is enabled, and the diff between two screens is the output needed to
+	 * turn one into the other.
+	 */
+	class Screen {
+		public:
+			/** The colors and attributes applied to newly written cells. Only the style of the cell is used. */
+			using Pen = Cell;
+
+		private:
+			enum class State {Ground, Escape, CSI, String, StringEscape};
+
+			int width = 0, height = 0;
+			std::vector<Cell> cells;
+
+			/** The cursor position, always relative to the top left of the screen regardless of origin mode. */
+			int cursorX = 0, cursorY = 0;
+
+			/** Set when a character has been written to the last column and the next one should wrap. */
+			bool pendingWrap = false;
+
+			/** Inclusive scrolling region boundaries. */
+			int top = 0, bottom = 0, left = 0, right = 0;
+
+			bool hmarginsEnabled = false, originMode = false, autowrap = true;
+
+			struct {
+				int x = 0, y = 0;
+				Pen pen;
+				bool originMode = false;
+			} saved;
+
+			/** The most recently printed character, for REP. */
+			std::string lastGlyph;
+			int lastGlyphWidth = 1;
+
+			State state = State::Ground;
+			std::string params, utf8;
+			size_t utf8Expected = 0;
+
+			void print(const std::string &glyph, int glyph_width);
+			void linefeed();
+			void carriageReturn();
+			void escape(char);
+			void dispatchCSI(char);
+			void sgr(const std::vector<int> &);
+			void setMode(const std::vector<int> &, bool is_private, bool enable);
+
+			/** Scrolls the rows in the scrolling region. Positive numbers move content up. */
+			void scroll(int rows);
+
+			/** Blanks a rectangle of cells (inclusive bounds) with the current background. */
+			void erase(int x1, int y1, int x2, int y2);
+
+			/** Moves the cursor to a position relative to the origin, clamping it to the appropriate bounds. */
+			void moveTo(int x, int y);
+
+			/** Returns a cell that has been blanked with the current background color. */
+			Cell blank() const;
+
+			int minX() const { return hmarginsEnabled && left <= cursorX && cursorX <= right? left  : 0; }
+			int maxX() const { return hmarginsEnabled && left <= cursorX && cursorX <= right? right : width - 1; }
+
+			/** Returns the glyphs between two columns of a row (exclusive of `to_x`) if reprinting them with the current
+			 *  style wouldn't change anything. */
+			std::optional<std::string> overwrite(const Pen &current, int from_x, int to_x, int y) const;
+
+			/** Returns a hash of the contents of a row. */
+			uint64_t rowHash(int y) const;
+
+			/** Returns whether a row is identical to a row of another screen of the same width. */
+			bool sameRow(const Screen &other, int y, int other_y) const;
+
+			/** Returns roughly how many bytes it takes to paint a row. */
+			int rowCost(int y) const;
+
+			/** Finds the largest block of rows that has shifted vertically relative to `front`, in the spirit of
+			 *  ncurses' hashmap scrolling, and returns a DECSTBM + SU/SD sequence that moves it into place if that's
+			 *  cheaper than repainting it. `front` is updated to reflect the scroll. */
+			std::string scrollFront(Screen &front, const Pen &current) const;
+
+			static std::vector<int> parseParams(const std::string &, int default_value);
+
+		public:
+			/** The current drawing style. */
+			Pen pen;
+
+			bool cursorVisible = true;
+
+			Screen(int width_ = 0, int height_ = 0);
+
+			/** Resizes the screen. Contents are preserved where they fit. This also resets the margins. */
+			void resize(int width_, int height_);
+
+			/** Blanks every cell and homes the cursor without changing the pen or the margins. */
+			void clear();
+
+			/** Interprets a chunk of terminal output. Sequences may be split across calls. */
+			void feed(std::string_view);
+
+			/** Returns the cell at a given position. Bounds are not checked. */
+			Cell & at(int x, int y) { return cells[y * width + x]; }
+			const Cell & at(int x, int y) const { return cells[y * width + x]; }
+
+			/** Returns the plain text of a row, without styling. */
+			std::string rowText(int y) const;
+
+			int getWidth()   const { return width;   }
+			int getHeight()  const { return height;  }
+			int getCursorX() const { return cursorX; }
+			int getCursorY() const { return cursorY; }
+
+			/** Produces the output that turns `front` (what's currently displayed) into this screen. It assumes no
+			 *  margins are in effect on the display. The cells, pen, cursor and cursor visibility of `front` are
+			 *  updated to reflect the new contents of the display. */
+			std::string diff(Screen &front) const;
+
+			/** Returns the shortest sequence that moves the cursor between two positions on a display with this
+			 *  screen's contents, in the spirit of ncurses' mvcur: absolute positioning, VPA and CHA, relative
+			 *  movement, carriage returns and line feeds, or reprinting the cells in between when they already have
+			 *  the current style. A negative starting coordinate means the cursor position isn't known. */
+			std::string planMove(const Pen &current, int from_x, int from_y, int to_x, int to_y) const;
+
+			/** Returns the SGR sequence that changes the style of one pen into another, or an empty string if they
+			 *  already match. */
+			static std::string transition(const Pen &from, const Pen &to);
+
+			/** Returns the number of columns occupied by a codepoint. */
+			static int glyphWidth(uint32_t codepoint);
+	};
+}
+
+#endif
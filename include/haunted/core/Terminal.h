@@ -1,17 +1,30 @@
 #ifndef HAUNTED_CORE_TERMINAL_H_
 #define HAUNTED_CORE_TERMINAL_H_
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <iostream>
 #include <memory>
 #include <mutex>
+#include <sstream>
 #include <thread>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
 #include <termios.h>
+#include <unistd.h>
 
+#include "haunted/core/EventLoop.h"
+#include "haunted/core/EventQueue.h"
+#include "haunted/core/InputDecoder.h"
+#include "haunted/core/InputRecording.h"
 #include "haunted/core/Key.h"
+#include "haunted/core/Metrics.h"
 #include "haunted/core/Mouse.h"
+#include "haunted/core/OutputQueue.h"
+#include "haunted/core/Screen.h"
 #include "haunted/ui/Coloration.h"
 #include "haunted/ui/Container.h"
 
@@ -19,19 +32,72 @@
 #include "lib/formicine/performance.h"
 
 namespace Haunted {
+	/**
+	 * Describes which optional sequences a terminal supports. These are used to produce less output where possible.
+	 */
+	struct Capabilities {
+		/** ECH (erase characters). Supported by nearly everything descended from the VT220. */
+		bool ech = true;
+		/** REP (repeat the preceding character). */
+		bool rep = false;
+		/** DECERA (erase rectangular area). Requires VT420 emulation. */
+		bool decera = false;
+	};
+
 	/**
 	 * This class enables interaction with terminals. It uses termios to change terminal modes.
 	 * When the destructor is called, it resets the modes to their original values.
 	 */
 	class Terminal: public UI::Container {
 		private:
-			std::mutex outputMutex;
+			mutable std::mutex outputMutex;
 			std::mutex winchMutex;
 			std::recursive_mutex renderMutex;
 			std::thread inputThread;
 			termios original;
 
+			/** Input events waiting for the dispatch thread (or dispatchInput) to send them to controls. */
+			EventQueue inputQueue;
+			std::thread dispatchThread;
+			/** Cleared to make the input thread stop reading. */
+			std::atomic<bool> reading = false;
+			/** Set by the input thread once the input has ended. */
+			std::atomic<bool> inputEnded = false;
+			/** Written to by stopInput to wake the input thread if it's waiting for input. */
+			int inputWakeFd = -1;
+
+			/** Controls waiting to be drawn by the render thread. */
+			std::unordered_set<UI::Control *> dirtyControls;
+			std::mutex dirtyMutex;
+			std::condition_variable renderCondition;
+			std::thread renderThread;
+			bool rendering = false;
+
+			/** The minimum amount of time between two frames drawn by the render thread. */
+			std::chrono::nanoseconds frameInterval = std::chrono::nanoseconds(1'000'000'000 / 60);
+
+			/** Frames waiting to be written by the output thread. Drawing threads push to it without any locks. */
+			OutputQueue outputQueue;
+			std::thread outputThread;
+			std::atomic<bool> queueing = false;
+
+			/** The maximum number of fragments the output thread combines into one write. */
+			static constexpr size_t maxBatch = 64;
+
 			MouseMode mmode = MouseMode::None;
+			bool pasteMode = false;
+
+			/** Created the first time it's needed. */
+			std::unique_ptr<EventLoop> loop;
+
+			/** Decodes input read from the terminal. Events decoded but not yet returned by operator>> wait in
+			 *  pendingInput. */
+			InputDecoder decoder;
+			std::vector<InputDecoder::Event> pendingInput;
+			size_t pendingIndex = 0;
+
+			/** Records raw input as it's read, if recording. */
+			std::unique_ptr<InputRecorder> recorder;
 
 			UI::Control *root = nullptr;
 
@@ -40,25 +106,178 @@ namespace Haunted {
 
 			int rows, cols;
 
+			/** Whether output is drawn into the back buffer instead of being written to the output stream directly. */
+			std::atomic<bool> buffered = false;
+
+			/** Statistics about the most recently committed frame. */
+			FrameStats lastFrame;
+
+			/** The front buffer reflects what's currently displayed; the back buffer reflects what should be. Both are
+			 *  only touched while the output mutex is locked. */
+			Screen frontBuffer, backBuffer;
+
+			/** A margin and origin state, used to skip sequences that wouldn't change anything. Margins of -1 mean the
+			 *  margins are reset. */
+			struct MarginState {
+				bool hmarginsEnabled = false, origin = false;
+				ssize_t top = -1, bottom = -1, left = -1, right = -1;
+
+				/** Set when no control needs the current margins anymore. Resetting them is put off until some other
+				 *  output is written so that a control that sets the same margins again doesn't have to reset them. */
+				bool resetPending = false;
+
+				/** Returns whether the margins and origin mode are at the terminal's defaults. */
+				bool isDefault() const { return !hmarginsEnabled && !origin && top == -1 && bottom == -1; }
+
+				/** Returns the sequences that put whatever differs from the defaults back. */
+				std::string resetSequence() const;
+			};
+
+			/** Output that one thread has produced since it last flushed or committed a frame, while buffering is
+			 *  enabled, a frame is in progress or the output thread is running. Every thread has its own, so threads
+			 *  drawing at the same time never wait on each other. A fragment assumes that the margins are at their
+			 *  defaults when it starts and puts them back when it's committed, so fragments from different threads can
+			 *  be written in any order. It doesn't inherit the cursor position, though: whatever a fragment draws
+			 *  should begin with a jump. */
+			struct Fragment {
+				std::ostringstream capture;
+				ansi::ansistream stream {capture, capture};
+				MarginState margins;
+				/** The number of frames the thread has begun but not yet committed. */
+				int depth = 0;
+				/** When the outermost frame in progress was begun. */
+				std::chrono::steady_clock::time_point started;
+			};
+
+			/** Fragments by the thread they belong to. The mutex is only locked the first time a thread draws. */
+			std::unordered_map<std::thread::id, std::unique_ptr<Fragment>> fragments;
+			std::mutex fragmentMutex;
+
+			/** Identifies the terminal in each thread's cache of the fragment it used last. The address isn't enough,
+			 *  because a new terminal can be allocated where an old one was. */
+			const uint64_t id = nextId++;
+			static std::atomic<uint64_t> nextId;
+
+			/** The margin state of the terminal as left by output written to the output stream directly. Only touched
+			 *  while the output mutex is locked. */
+			MarginState directMargins;
+
+			/** Where a write should go and the margin state that applies there. */
+			struct Target {
+				ansi::ansistream &stream;
+				MarginState &margins;
+				/** Holds the output mutex if the target is the output stream. */
+				std::unique_lock<std::mutex> lock;
+			};
+
+			/** Returns the calling thread's fragment, creating it if necessary. */
+			Fragment & getFragment();
+
+			/** Returns where output should be written to: the calling thread's fragment if buffering is enabled, a
+			 *  frame is in progress or the output thread is running, or the output stream with the output mutex locked
+			 *  otherwise. This also performs any pending margin reset unless `reset_margins` is false. */
+			Target target(bool reset_margins = true);
+
+			/** Takes everything in a fragment and hands it to the output thread if it's running. Otherwise, it's
+			 *  written (or its difference from the front buffer if buffering is enabled) right away. */
+			void commitFragment(Fragment &);
+
+			/** Writes a frame's worth of data to the output file descriptor all at once, wrapped in synchronized update
+			 *  brackets, and records its statistics. Returns whether anything was written. The output mutex should be
+			 *  locked. */
+			bool writeFrame(std::string, std::chrono::steady_clock::time_point started);
+
+			/** Writes a batch of up to maxBatch chunks popped from the output queue, starting with one that's already
+			 *  been popped, in a single frame. The back buffer is only diffed once for the whole batch. */
+			void writeQueued(OutputQueue::Chunk &);
+
+			/** Locks the output mutex, recording any time spent waiting for it. */
+			std::unique_lock<std::mutex> lockOutput() { return metrics.lock(outputMutex, metrics.outputLock); }
+
 			/** Applies the attributes in `attrs` to the terminal. */
 			virtual void apply();
 
 			/** Restores the terminal attributes to what they were before any changes were applied. */
 			virtual void reset();
 
-			/** Repeatedly reads from the terminal in a loop and dispatches the key presses to the focused control. */
+			/** Repeatedly reads from the terminal in a loop and pushes the decoded events to the input queue. */
 			virtual void workInput();
 
-			/** Handles window resizes. */
-			virtual void winch(int, int);
+			/** Dispatches events from the input queue as they arrive until ^c is pressed or the input ends. */
+			virtual void workDispatch();
+
+			/** Reads as much input as is available (at least one byte) and appends the events it completes to a
+			 *  vector. If the input ends in a partial sequence and `wait` is true, it waits up to escapeTimeout for the
+			 *  rest before resolving it. Returns false if the input has ended. */
+			bool readInput(std::vector<InputDecoder::Event> &, bool wait = true);
+
+			/** Waits until input is available on inFd or a timeout elapses. Returns whether input is available. */
+			bool pollInput(std::chrono::milliseconds timeout);
+
+			/** Resolves a partial sequence in the decoder, noting it in the recording if there is one. */
+			void flushDecoder(std::vector<InputDecoder::Event> &);
+
+			/** Merges consecutive mouse reports in a batch of input: motion reports are reduced to the latest one and
+			 *  scroll reports at the same position are summed into one with a count. Other events are left alone and
+			 *  never reordered. */
+			static void coalesceMouse(std::vector<InputDecoder::Event> &);
+
+			/** Offers an event to a control and then to each of its ancestors in turn, ending with the terminal, until
+			 *  one of them handles it. Returns the one that handled it, or null. */
+			template <typename F>
+			UI::InputHandler * bubble(UI::Control *, F handle);
 
-			// signal() takes a pointer to a static function. To get around this, every terminal object whose
-			// watch_size() method is called adds itself to a static vector of terminal pointers. When the WINCH signal
-			// handler is called, it notifies all the listening terminal objects of the terminal's new dimensions.
+			/** Binds key combinations common to most console programs: ^l redraws and ^y prints debug information. */
+			void bindDefaultKeys();
 
-			/** Notifies terminal objects of a window resize. */
+			/** Decodes pasted text into the key presses it would have produced without bracketed paste mode. */
+			static std::vector<InputDecoder::Event> pasteKeys(const std::string &);
+
+			/** Tracks dragging for a mouse report and sends it to the appropriate control. */
+			void dispatchMouse(MouseReport);
+
+			/** Sends a batch of decoded input to the appropriate controls. Returns false if ^c was pressed and the
+			 *  interrupt handler agreed to quit. */
+			bool handleInput(std::vector<InputDecoder::Event> &);
+
+			/** Sends a single decoded event to the appropriate control. Returns false if ^c was pressed and the
+			 *  interrupt handler agreed to quit. */
+			bool handleEvent(InputDecoder::Event &);
+
+			/** Waits for controls to be marked as dirty and draws them, at most once per frame interval. */
+			virtual void workRender();
+
+			/** Writes the fragments in the output queue to the output file descriptor as they arrive, combining any
+			 *  that arrive together into a single write. */
+			virtual void workOutput();
+
+			/** Writes data to the output file descriptor, retrying as necessary. Returns the number of write(2) calls
+			 *  it took. */
+			size_t writeAll(const std::string &);
+
+			/** Writes a sequence that isn't part of the drawn contents, like a mode change, bypassing the back buffer
+			 *  and any fragments. The output mutex should be locked. */
+			void writeDirect(const std::string &);
+
+			/** Draws a set of controls in a single frame, skipping any whose ancestors are also in the set. The render
+			 *  lock should be held. */
+			void drawControls(const std::unordered_set<UI::Control *> &);
+
+			// A signal handler can't safely do anything that takes a lock, which resizing and redrawing do. Instead, the
+			// SIGWINCH handler only writes to winchFd, which the input threads of terminals whose watchSize() method
+			// has been called wait on along with their input. Whichever input thread reads it first notifies all the
+			// watching terminals of the new dimensions.
+
+			/** Wakes the input threads waiting for a window resize. Async-signal-safe. */
 			static void winchHandler(int);
+			/** Created the first time watchSize is called. Written to by winchHandler. */
+			static std::atomic<int> winchFd;
 			static std::vector<Terminal *> winchTargets;
+			static std::mutex winchTargetsMutex;
+
+			/** Called by an input thread when winchFd is readable. Notifies the watching terminals of the new
+			 *  dimensions unless another input thread already has. */
+			static void handleWinch();
 
 			/** Returns the terminal attributes from tcgetaddr. */
 			static termios getattr();
@@ -66,6 +285,18 @@ namespace Haunted {
 			/** Sets the terminal attributes with tcsetaddr. */
 			static void setattr(const termios &);
 
+		protected:
+			/** Whether the terminal is attached to a tty. Terminals that aren't don't touch the terminal attributes and
+			 *  don't write anything when destroyed. */
+			bool attached = true;
+
+			/** Handles window resizes. */
+			virtual void winch(int, int);
+
+			/** Writes a frame's worth of data to the output file descriptor. Returns the number of write(2) calls it
+			 *  took. The output mutex is locked. */
+			virtual size_t writeOutput(std::string);
+
 		public:
 			termios attrs;
 			bool raw = false;
@@ -73,6 +304,29 @@ namespace Haunted {
 			bool alive = true;
 			std::istream &inStream;
 			ansi::ansistream &outStream;
+
+			/** The file descriptor input is read from in large chunks. If it's negative, input is read from inStream
+			 *  instead, which is the default unless inStream is std::cin. */
+			int inFd = STDIN_FILENO;
+
+			/** Whether mouse motion and scroll reports that arrive together are merged before being dispatched, so
+			 *  that a burst of wheel notches becomes a single scroll. */
+			bool coalesce = true;
+
+			/** How long to wait after an escape for the rest of a sequence before deciding that the escape key itself
+			 *  was pressed. Terminals send whole sequences at once, so this only needs to cover network latency. */
+			std::chrono::milliseconds escapeTimeout {25};
+
+			/** The file descriptor that committed frames are written to. It should refer to the same file as
+			 *  outStream, which is flushed before every frame to keep output in order. */
+			int outFd = STDOUT_FILENO;
+
+			/** The optional sequences the terminal is known to support. */
+			Capabilities capabilities;
+
+			/** Whether to wrap frames in DEC mode 2026 (synchronized update) so the terminal paints them atomically.
+			 *  Terminals that don't support the mode ignore it. */
+			bool synchronizedUpdates = true;
 			UI::Coloration colors;
 
 			bool dragging = false;
@@ -84,6 +338,12 @@ namespace Haunted {
 			/** Called after a mouse event is processed. */
 			std::function<void(const MouseReport &)> mousePostlistener {};
 
+			/** Called after a frame is written, outside of any locks. */
+			std::function<void(const FrameStats &)> framePostlistener {};
+
+			/** Statistics about output and rendering. */
+			Metrics metrics;
+
 			/** Called when the client receives ^c. If this returns true, the client will quit. */
 			std::function<bool()> onInterrupt {[]() { return true; }};
 
@@ -91,6 +351,9 @@ namespace Haunted {
 			Terminal(std::istream &in_stream): Terminal(in_stream, ansi::out) {}
 			Terminal(): Terminal(std::cin) {}
 
+			/** Creates a terminal of a given size that isn't attached to a tty. */
+			Terminal(std::istream &, ansi::ansistream &, int rows_, int cols_);
+
 			Terminal(const Terminal &) = delete;
 
 			/** Resets terminal attributes and joins threads as necessary. */
@@ -99,7 +362,8 @@ namespace Haunted {
 			/** Activates cbreak mode. */
 			virtual void cbreak();
 
-			/** Sets a handler to respond to SIGWINCH signals. */
+			/** Sets a handler to respond to SIGWINCH signals. Resizes are handled on the input thread, so this has no
+			 *  effect unless startInput is called and input is read from a file descriptor. */
 			virtual void watchSize();
 
 			/** Redraws the entire screen if a root control exists. This also adjusts the size and position of the root
@@ -122,18 +386,122 @@ namespace Haunted {
 
 			virtual UI::InputHandler * sendMouse(const MouseReport &);
 
-			/** Handles key combinations common to most console programs. */
+			/** Sends pasted text to the focused control, passing it up the hierarchy until something handles it. If
+			 *  nothing does, the text is sent as key presses. */
+			virtual UI::InputHandler * sendPaste(const std::string &);
+
+			/** Handles key combinations common to most console programs by looking them up in the keymap, where ^l
+			 *  redraws and ^y prints debug information unless they've been rebound. */
 			virtual bool onKey(const Key &) override;
 
-			/** Starts the input-reading thread. */
-			virtual void startInput();
+			/** Calls onKey, which already consults the keymap, so that subclasses overriding onKey still see every
+			 *  key that reaches the terminal. */
+			virtual bool handleKey(const Key &) override;
+
+			/** Starts the input-reading thread. Input is decoded there and handed over through a lock-free queue, so
+			 *  controls only ever handle input on one thread: a dispatch thread started here if `dispatch` is true, or
+			 *  otherwise whichever thread calls dispatchInput. */
+			virtual void startInput(bool dispatch = true);
+
+			/** Stops the input-reading and dispatch threads. */
+			virtual void stopInput();
+
+			/** Dispatches all the input events waiting in the queue on the calling thread. Returns false if ^c was
+			 *  pressed and the interrupt handler agreed to quit, or if the input has ended and the queue is empty. */
+			bool dispatchInput();
+
+			/** Returns the queue between the input thread and the thread dispatching input, for its statistics. */
+			const EventQueue & getInputQueue() const { return inputQueue; }
+
+			/** Starts writing all raw input read from the terminal to a file, along with when it arrived. This should be
+			 *  called before input starts being read. Throws std::runtime_error if the file can't be opened. */
+			void startRecording(const std::string &path);
+
+			/** Stops recording input and closes the recording. */
+			void stopRecording();
+
+			/** Feeds a recording made by startRecording through the decoder and dispatches the events on the calling
+			 *  thread as if they had been read from the terminal. If `realtime` is true, the original timing is
+			 *  reproduced; otherwise the recording is replayed as fast as possible. Either way, the same events are
+			 *  dispatched. Returns false if replaying was stopped by ^c. Throws std::runtime_error if the recording
+			 *  can't be read. */
+			bool replay(const std::string &path, bool realtime = false);
+
+			/** Returns the terminal's event loop, creating it if necessary. Applications can register their own file
+			 *  descriptors and timers with it. */
+			EventLoop & getLoop();
+
+			/** Runs the event loop on the calling thread until ^c is pressed (and the interrupt handler agrees) or the
+			 *  loop is stopped. Input and window resizes are handled on the loop, so the application's I/O and the UI
+			 *  can share one thread. This is an alternative to startInput and watchSize. */
+			virtual void run();
+
+			/** Starts the output thread. Until it's stopped, all output is collected in each thread's fragment and
+			 *  flushing or committing a frame pushes the fragment to the output thread without locking anything, so
+			 *  threads that draw never wait on the terminal or on each other. */
+			virtual void startOutput();
+
+			/** Hands the calling thread's remaining output to the output thread, waits for it to be written and stops
+			 *  the thread. */
+			virtual void stopOutput();
+
+			/** Starts the render thread. Until it's stopped, controls that request to be drawn are drawn together at
+			 *  most once per frame instead of immediately. */
+			virtual void startRendering();
+
+			/** Draws any remaining dirty controls and stops the render thread. */
+			virtual void stopRendering();
+
+			/** Returns whether the render thread is running. */
+			bool isRendering() const { return rendering; }
+
+			/** Sets the maximum number of frames per second the render thread draws. Zero removes the limit. */
+			virtual void setFrameRate(double);
+
+			/** If the render thread is running, marks a control as needing to be drawn and returns true. Otherwise,
+			 *  returns false to indicate that the caller should draw the control itself. */
+			bool requestDraw(UI::Control *);
+
+			/** Removes a control from the set of dirty controls. Called when a control is destroyed. */
+			void cancelDraw(UI::Control *);
 
 			/** Joins all the terminal's threads. */
 			virtual void join();
 
-			/** Flushes the output stream. */
+			/** Flushes the output stream. If the calling thread has output in its fragment, this first commits it (or
+			 *  the difference between the back buffer and the front buffer if buffering is enabled). */
 			virtual void flush();
 
+			/** Begins a frame. Until the matching call to commitFrame, all output from the calling thread is collected
+			 *  in its fragment. Frames can be nested; only committing the outermost one writes anything. Each thread
+			 *  has its own frames. */
+			virtual void beginFrame();
+			/** Ends a frame. If it's the outermost frame, the collected output is written with as few write(2) calls
+			 *  as possible (normally one), wrapped in synchronized update brackets, or pushed to the output thread if
+			 *  it's running. */
+			virtual void commitFrame();
+			/** Returns statistics about the most recently written frame. */
+			virtual FrameStats getLastFrame() const;
+
+			/** Begins a frame that's committed when the returned object is destroyed. */
+			class Frame {
+				private:
+					Terminal *terminal;
+
+				public:
+					Frame(Terminal *terminal_): terminal(terminal_) { terminal->beginFrame(); }
+					Frame(const Frame &) = delete;
+					~Frame() { terminal->commitFrame(); }
+			};
+
+			Frame frame() { return Frame(this); }
+
+			/** Enables or disables double buffering. While it's enabled, output is applied to an in-memory copy of the
+			 *  screen and only the cells that changed are written to the terminal when flushing. */
+			virtual void setBuffered(bool);
+			/** Returns whether double buffering is enabled. */
+			virtual bool isBuffered() const { return buffered; }
+
 			/** Focuses a control. */
 			virtual void focus(UI::Control *);
 			/** Returns the focused control. If none is currently selected, this function focuses the root control. */
@@ -166,29 +534,51 @@ namespace Haunted {
 
 			/** Jumps to a position on the screen. */
 			virtual void jump(int x, int y = -1);
-			virtual void    up(size_t n = 1) { outStream.up(n);    }
-			virtual void  down(size_t n = 1) { outStream.down(n);  }
-			virtual void right(size_t n = 1) { outStream.right(n); }
-			virtual void  left(size_t n = 1) { outStream.left(n);  }
-			virtual void clearLine()  { outStream.clear_line();  }
-			virtual void clearRight() { outStream.clear_right(); }
-			virtual void clearLeft()  { outStream.clear_left();  }
-			virtual void front() { outStream.hpos(0); }
-			virtual void back()  { outStream.hpos(cols); }
+			virtual void    up(size_t n = 1);
+			virtual void  down(size_t n = 1);
+			virtual void right(size_t n = 1);
+			virtual void  left(size_t n = 1);
+			virtual void clearLine();
+			virtual void clearRight();
+			virtual void clearLeft();
+			/** Erases a rectangle using the cheapest combination of sequences the terminal supports, falling back to
+			 *  printing spaces only when nothing else applies. The coordinates are interpreted like those passed to
+			 *  jump, so they're relative to the margins in origin mode. The cursor position afterwards is unspecified. */
+			virtual void clearRect(int x, int y, int width, int height);
+			virtual void front();
+			virtual void back();
+			/** Saves the cursor position. */
+			virtual void save();
+			/** Restores the cursor position. */
+			virtual void restore();
 
 			/** Makes the cursor visible. */
-			virtual void show() { outStream.show(); }
+			virtual void show();
 			/** Makes the cursor invisible. */
-			virtual void hide() { outStream.hide(); }
+			virtual void hide();
 
 			/** Sets the mouse-reporting mode. */
 			virtual void mouse(MouseMode);
 			/** Returns the current mouse mode. */
 			virtual MouseMode mouse() const { return mmode; }
 
+			/** Enables or disables bracketed paste mode, in which pasted text arrives as a single paste event instead
+			 *  of one key press per byte. */
+			virtual void bracketedPaste(bool);
+			/** Returns whether bracketed paste mode is enabled. */
+			virtual bool bracketedPaste() const { return pasteMode; }
+
 			/** Scrolls the screen vertically. Negative numbers scroll up, positive numbers scroll down. */
 			virtual void vscroll(int rows = 1);
 
+			/** Sets the margins and enables origin mode for a control that's about to draw. Margin and origin
+			 *  sequences are only written if the terminal isn't already in the requested state. Like DECSTBM, this may
+			 *  move the cursor, so callers should jump afterwards. Zero-based. */
+			virtual void claimMargins(size_t top, size_t bottom, size_t left, size_t right);
+			/** Indicates that the margins set by claimMargins are no longer needed. They're reset the next time any
+			 *  other output is written unless they're claimed again first. */
+			virtual void releaseMargins();
+
 			/** Sets the horizontal margins of the scrollable area. Zero-based. */
 			virtual void hmargins(size_t left, size_t right);
 			/** Resets the horizontal margins of the scrollable area. */
@@ -224,13 +614,16 @@ namespace Haunted {
 
 			void debugTree();
 
+			/** Writes a summary of the terminal's metrics to the debug stream. */
+			void debugMetrics();
+
 			/** Writes pretty much anything to the terminal. */
 			template <typename T>
 			Terminal & operator<<(const T &t) {
 				auto w = formicine::perf.watch("template <T> operator<<(Terminal, T)");
 				if (!suppressOutput) {
-					std::unique_lock uniq(outputMutex);
-					outStream << t;
+					Target out = target();
+					out.stream << t;
 				}
 
 				return *this;
@@ -239,8 +632,8 @@ namespace Haunted {
 			/** Deactivates a formicine style or color. */
 			template <typename T>
 			Terminal & operator>>(const T &t) {
-				std::unique_lock uniq(outputMutex);
-				outStream >> t;
+				Target out = target();
+				out.stream >> t;
 				return *this;
 			}
 	};
@@ -395,6 +395,22 @@ namespace Haunted::Tests {
 			static void unittest_textbox(Testing &);
 			static void unittest_expandobox(Testing &);
 			static void unittest_ustring(Testing &);
+			static void unittest_screen(Testing &);
+			static void unittest_headless(Testing &);
+			static void unittest_outputqueue(Testing &);
+			static void unittest_metrics(Testing &);
+			static void unittest_inputdecoder(Testing &);
+			static void unittest_eventloop(Testing &);
+			static void unittest_eventqueue(Testing &);
+			static void unittest_keymap(Testing &);
+			static void unittest_bubblepath(Testing &);
+			static void unittest_spatialindex(Testing &);
+			static void unittest_inputrecording(Testing &);
+			static void unittest_rowindex(Testing &);
+			static void unittest_scrollback(Testing &);
+			static void unittest_append(Testing &);
+			static void unittest_textline(Testing &);
+			static void unittest_rewrap(Testing &);
 	};
 }
 
@@ -1,6 +1,9 @@
 #ifndef HAUNTED_UI_CHILD_H_
 #define HAUNTED_UI_CHILD_H_
 
+#include <atomic>
+#include <cstdint>
+
 namespace Haunted::UI {
 	class Container;
 
@@ -12,11 +15,15 @@ namespace Haunted::UI {
 			Container *parent;
 
 		public:
+			/** Incremented whenever any child gets a new parent or is destroyed, so cached paths up the hierarchy
+			 *  can tell when they're out of date. */
+			static std::atomic<uint64_t> hierarchyVersion;
+
 			Child(Container *parent_ = nullptr): parent(parent_) {}
 			Child(const Child &) = delete;
 			Child & operator=(const Child &) = delete;
 
-			virtual ~Child() = default;
+			virtual ~Child() { ++hierarchyVersion; }
 
 			Container * getParent();
 			virtual void setParent(Container *);
@@ -1,10 +1,12 @@
 #ifndef HAUNTED_UI_COLORATION_H_
 #define HAUNTED_UI_COLORATION_H_
 
-#include <mutex>
-
 #include "lib/formicine/ansi.h"
 
+namespace Haunted {
+	class Terminal;
+}
+
 namespace Haunted::UI {
 	/**
 	 * Class for handling terminal colors. Each Haunted::terminal keeps one of these.
@@ -12,15 +14,12 @@ namespace Haunted::UI {
 	 */
 	class Coloration {
 		private:
-			ansi::ansistream *outStream;
-			std::mutex *mutex;
+			Terminal *terminal;
 			ansi::color lastForeground = ansi::color::normal;
 			ansi::color lastBackground = ansi::color::normal;
 
-			std::unique_lock<std::mutex> getLock() { return std::unique_lock(*mutex); }
-
 		public:
-			Coloration(ansi::ansistream *out_stream, std::mutex *mutex_): outStream(out_stream), mutex(mutex_) {}
+			Coloration(Terminal *terminal_): terminal(terminal_) {}
 
 			/** Attempts to set the foreground. Returns whether the given foreground is different from the last one. */
 			bool setForeground(ansi::color);
@@ -6,6 +6,7 @@
 #include "haunted/core/Defs.h"
 #include "haunted/core/Util.h"
 #include "haunted/ui/InputHandler.h"
+#include "haunted/ui/SpatialIndex.h"
 
 namespace Haunted {
 	class Terminal;
@@ -26,8 +27,19 @@ namespace Haunted::UI {
 
 		protected:
 			Type children;
-		
+
+		private:
+			/** Built by childAtOffset when there are enough children and rebuilt whenever the layout has changed. */
+			mutable SpatialIndex index;
+			mutable uint64_t indexVersion = 0;
+			mutable size_t indexedCount = 0;
+
 		public:
+			/** Containers with at least this many children find children by position with a spatial index instead
+			 *  of checking each child in turn. */
+			static constexpr size_t indexThreshold = 16;
+
+			Container() { asContainer = this; }
 			virtual ~Container();
 
 			/** Adds a child to the container. Returns true if successful. */
@@ -1,6 +1,8 @@
 #ifndef HAUNTED_UI_CONTROL_H_
 #define HAUNTED_UI_CONTROL_H_
 
+#include <vector>
+
 #include "haunted/core/Defs.h"
 #include "haunted/core/Key.h"
 #include "haunted/ui/Child.h"
@@ -26,11 +28,19 @@ namespace Haunted::UI {
 			/** The absolute position of the control on the screen. */
 			Haunted::Position position;
 
+			/** The control followed by its ancestors, as of the hierarchy version in bubblePathVersion. */
+			std::vector<InputHandler *> bubblePathCache;
+			uint64_t bubblePathVersion = 0;
+
 			/** Sets the margins if needed, executes a function and resets the margins if needed. Returns true if the
 			 *  margins were set. */
 			bool tryMargins(std::function<void()>);
 
 		public:
+			/** Incremented whenever any control is resized or moved or a container gains or loses a child, so
+			 *  spatial indices can tell when they're out of date. */
+			static std::atomic<uint64_t> layoutVersion;
+
 			/** Whether to ignore this control when calculating the indices of the other children of this control's
 			 *  parent. */
 			bool ignoreIndex = false;
@@ -43,11 +53,13 @@ namespace Haunted::UI {
 			Control & operator=(const Control &) = delete;
 
 			Control(Container *parent_, const Haunted::Position &position_);
-			Control(const Haunted::Position &position_): Child(nullptr), terminal(nullptr), position(position_) {}
+			Control(const Haunted::Position &position_): Child(nullptr), terminal(nullptr), position(position_) {
+				asControl = this;
+			}
 			Control(Container *parent_, Terminal *terminal_);
 			Control(Container *parent_);
 
-			virtual ~Control() = default;
+			virtual ~Control();
 
 			/** Returns the control's identifier. */
 			virtual std::string getID(bool pad = false) const;
@@ -61,6 +73,10 @@ namespace Haunted::UI {
 			/** Renders the control on the terminal. */
 			virtual void draw() = 0;
 
+			/** If the terminal's render thread is running, schedules the control to be drawn in the next frame and
+			 *  returns true. Otherwise, returns false and the caller is expected to draw immediately. */
+			bool requestDraw();
+
 			/** Returns whether the control's in a state in which it can be rendered. */
 			virtual bool canDraw() const;
 
@@ -80,6 +96,10 @@ namespace Haunted::UI {
 			virtual void setParent(Container *) override;
 
 			virtual Container * getParent() const { return parent; }
+
+			/** Returns the control followed by its parent, its parent's parent and so on up to the terminal: the
+			 *  handlers that input sent to the control bubbles through. It's cached until the hierarchy changes. */
+			const std::vector<InputHandler *> & bubblePath();
 			virtual Terminal * getTerminal() { return terminal; }
 			void setTerminal(Terminal *terminal_) { terminal = terminal_;  }
 
@@ -2,11 +2,17 @@
 #define HAUNTED_UI_INPUTHANDLER_H_
 
 #include <functional>
+#include <memory>
+#include <string>
 
 #include "haunted/core/Key.h"
+#include "haunted/core/Keymap.h"
 #include "haunted/core/Mouse.h"
 
 namespace Haunted::UI {
+	class Container;
+	class Control;
+
 	/**
 	 * An input handler is anything that can handle key presses or mouse events.
 	 * This includes controls and containers.
@@ -14,6 +20,13 @@ namespace Haunted::UI {
 	class InputHandler {
 		using   KeyHandler_f = std::function<bool(const Key &)>;
 		using MouseHandler_f = std::function<bool(const MouseReport &)>;
+		using PasteHandler_f = std::function<bool(const std::string &)>;
+
+		protected:
+			/** Set by the Control and Container constructors to the handler's own address as that type, so a handler
+			 *  can be converted without RTTI. Null if the handler isn't one. */
+			Control *asControl = nullptr;
+			Container *asContainer = nullptr;
 
 		public:
 			/** This is a key-handling function that can be changed during runtime to replace on_key. Like on_key, a
@@ -23,15 +36,35 @@ namespace Haunted::UI {
 
 			MouseHandler_f mouseFunction;
 
+			PasteHandler_f pasteFunction;
+
+			/** Key bindings that are checked before onKey. Several handlers can share a keymap, and a handler can
+			 *  switch between keymaps to change modes. */
+			std::shared_ptr<Keymap> keymap;
+
 			/** Handles a key input.
 			 *  If the function returns false, that means the key handler decided not to handle the key.
 			 *  If the key handler is a control or a container, then its parent's on_key method will be called.
 			 *  This can continue until the root is reached. */
 			virtual bool onKey(const Key &);
 
+			/** Looks a key up in the keymap, if there is one, and calls onKey if it isn't bound. Returns true if the
+			 *  key was handled or continued a chord. */
+			virtual bool handleKey(const Key &);
+
 			virtual bool onMouse(const MouseReport &);
 
+			/** Handles text pasted while bracketed paste mode is enabled. Like onKey, returning false passes the text
+			 *  up the hierarchy. If nothing handles it, the text is sent as individual key presses instead. */
+			virtual bool onPaste(const std::string &);
+
 			virtual ~InputHandler() = default;
+
+			/** Returns the handler as a control, or null if it isn't one. */
+			Control * toControl() const { return asControl; }
+
+			/** Returns the handler as a container, or null if it isn't one. */
+			Container * toContainer() const { return asContainer; }
 	};
 }
 
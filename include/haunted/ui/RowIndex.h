@@ -0,0 +1,69 @@
+#ifndef HAUNTED_UI_ROWINDEX_H_
+#define HAUNTED_UI_ROWINDEX_H_
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace Haunted::UI {
+	/**
+	 * Keeps track of how many rows each line of a textbox occupies. It's a Fenwick tree of the row counts, so finding
+	 * the line at a given row, finding the first row of a given line and changing a line's row count are O(log n), and
+	 * the total is O(1). Lines removed from the front keep their slots (with zero rows) until they make up half of the
+	 * tree, at which point it's compacted, so removing lines is amortized O(log n) too.
+	 */
+	class RowIndex {
+		private:
+			/** One-based; tree[i] holds the sum of the row counts of the lowbit(i) slots ending at slot i - 1. */
+			std::vector<size_t> tree {0};
+			/** The row count of each slot. */
+			std::vector<size_t> counts;
+			/** The number of slots at the front belonging to removed lines. */
+			size_t removed = 0;
+			size_t totalRows = 0;
+
+			/** Returns the sum of the row counts of the first `end` slots. */
+			size_t sum(size_t end) const;
+
+			/** Adds a (possibly negative) amount to a slot's row count. */
+			void add(size_t slot, ptrdiff_t delta);
+
+			/** Discards the slots of removed lines and rebuilds the tree in linear time. */
+			void compact();
+
+		public:
+			/** Returns the number of lines. */
+			size_t size() const { return counts.size() - removed; }
+			bool empty() const { return size() == 0; }
+
+			/** Returns the number of rows all the lines occupy. */
+			size_t total() const { return totalRows; }
+
+			void clear();
+			void reserve(size_t lines);
+
+			/** Returns the number of bytes the index has allocated. */
+			size_t memoryUsage() const { return (tree.capacity() + counts.capacity()) * sizeof(size_t); }
+
+			/** Adds a line to the end. */
+			void pushBack(size_t rows);
+
+			/** Removes lines from the front. */
+			void popFront(size_t count = 1);
+
+			/** Changes the number of rows a line occupies. */
+			void set(size_t index, size_t rows);
+
+			/** Returns the number of rows a line occupies. */
+			size_t rows(size_t index) const { return counts[removed + index]; }
+
+			/** Returns the number of rows above a line. */
+			size_t rowsBefore(size_t index) const { return sum(removed + index); }
+
+			/** Returns the index of the line at a given row and how many rows past the start of the line the row is.
+			 *  The row has to be less than total(). */
+			std::pair<size_t, size_t> find(size_t row) const;
+	};
+}
+
+#endif
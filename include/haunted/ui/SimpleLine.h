@@ -31,6 +31,12 @@ namespace Haunted::UI {
 
 		size_t getContinuation() override { return continuation; }
 
+		const std::string * storedText() override { return &text; }
+
+		size_t memoryUsage() const override {
+			return TextLine<C>::memoryUsage() + sizeof(*this) - sizeof(TextLine<C>) + TextLine<C>::heapUsage(text);
+		}
+
 		virtual bool operator==(SimpleLine &other) {
 			return getContinuation() == other.getContinuation() && text == other.text;
 		}
@@ -0,0 +1,48 @@
+#ifndef HAUNTED_UI_SPATIALINDEX_H_
+#define HAUNTED_UI_SPATIALINDEX_H_
+
+#include <deque>
+#include <vector>
+
+#include "haunted/core/Defs.h"
+
+namespace Haunted::UI {
+	class Control;
+
+	/**
+	 * Finds which of a set of controls covers a point in O(log n) time. The screen is cut into horizontal bands at
+	 * every control's top and bottom edge; each band holds the spans of the controls that cover it, sorted by their
+	 * left edges. A lookup is a binary search for the band followed by a binary search for the span. Where controls
+	 * overlap, the one that comes first in the original order wins, as with a linear scan.
+	 */
+	class SpatialIndex {
+		private:
+			struct Span {
+				ssize_t left, right;
+				/** The control's index in the order the controls were given in, for resolving overlaps. */
+				size_t order;
+				Control *control;
+			};
+
+			struct Band {
+				/** The first row of the band. It extends to the first row of the next band. */
+				ssize_t top;
+				std::vector<Span> spans;
+				/** Whether any of the spans overlap, in which case they're searched in their original order. */
+				bool overlapping = false;
+			};
+
+			std::vector<Band> bands;
+
+		public:
+			/** Rebuilds the index for a set of controls at their current positions. */
+			void build(const std::deque<Control *> &);
+
+			/** Returns the control at a point, or null if there isn't one. */
+			Control * find(ssize_t x, ssize_t y) const;
+
+			void clear() { bands.clear(); }
+	};
+}
+
+#endif
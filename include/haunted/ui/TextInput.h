@@ -231,6 +231,9 @@ namespace Haunted::UI {
 			/** Handles key presses. */
 			bool onKey(const Key &) override;
 
+			/** Inserts pasted text with a single change to the buffer and a single redraw. */
+			bool onPaste(const std::string &) override;
+
 			/** Renders the control onto the terminal. */
 			virtual void draw() override;
 
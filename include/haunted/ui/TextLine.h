@@ -1,9 +1,11 @@
 #ifndef HAUNTED_UI_TEXTLINE_H_
 #define HAUNTED_UI_TEXTLINE_H_
 
+#include <cstdint>
 #include <deque>
 #include <functional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "haunted/core/Mouse.h"
@@ -22,26 +24,60 @@ namespace Haunted::UI {
 	template <template <typename... T> typename C>
 	class TextLine {
 		public:
-			std::vector<std::string> lines_ {};
+			/** The byte offset in the text at which each row begins, cached by clean. Rows are stored as offsets rather
+			 *  than as copies of their text so that the cache costs four bytes per row instead of a whole row. */
+			std::vector<uint32_t> breaks_ {};
+			/** A copy of the text for lines that don't store it themselves, cached by clean. */
+			std::string text_ {};
 			ssize_t numRows_ = -1;
+			/** The width the cached rows were wrapped for. */
+			ssize_t width_ = -1;
 			bool dirty = true;
 			bool cleaning = false;
 			const bool *allowWrap = nullptr;
 
-			/** Caches the return values of num_rows and text_at_row. */
+			/** Returns the number of rows text of a given length would occupy. */
+			static size_t countRows(ssize_t length, ssize_t width, ssize_t continuation) {
+				if (length <= width)
+					return 1;
+
+				// Ignore all the text on the first line because it's not affected by continuation.
+				length -= width;
+				const ssize_t adjusted_continuation = width - (width == continuation? continuation - 1 : continuation);
+				return length / adjusted_continuation + (length % adjusted_continuation? 2 : 1);
+			}
+
+			/** Caches the number of rows and where each of them begins. A clean line is rewrapped if the width has
+			 *  changed since it was cleaned, so resizing a textbox doesn't have to mark every line as dirty. */
 			void clean(ssize_t width) {
-				if (!dirty || cleaning || (allowWrap && !*allowWrap))
+				if ((!dirty && width_ == width) || cleaning || (allowWrap && !*allowWrap))
 					return;
 
 				cleaning = true;
-				numRows_ = numRows(width);
-				for (ssize_t row = 0; row < numRows_; ++row)
-					lines_.push_back(textAtRow(width, row));
-
+				const std::string *stored = storedText();
+				if (!stored)
+					text_ = std::string(*this);
+				const std::string &text = stored? *stored : text_;
+
+				const ssize_t continuation = getContinuation();
+				numRows_ = countRows(ansi::length(text), width, continuation);
+				const ssize_t per_row = width - (width == continuation? continuation - 1 : continuation);
+				breaks_.assign(1, 0);
+				breaks_.reserve(numRows_);
+				for (ssize_t row = 1; row < numRows_; ++row)
+					breaks_.push_back(ansi::get_pos(text, width + (row - 1) * per_row));
+
+				width_ = width;
 				cleaning = false;
 				dirty = false;
 			}
 
+			/** Returns the text the rows refer to. Only valid while the line is clean. */
+			std::string_view cleanText() {
+				const std::string *stored = storedText();
+				return stored? *stored : text_;
+			}
+
 		public:
 			Textbox<C> *box = nullptr;
 			std::function<void(const MouseReport &)> mouseFunction;
@@ -56,7 +92,19 @@ namespace Haunted::UI {
 			void markDirty() {
 				dirty = true;
 				numRows_ = -1;
-				lines_.clear();
+				breaks_.clear();
+				text_.clear();
+			}
+
+			/** Returns the number of bytes a string has allocated outside of itself. */
+			static size_t heapUsage(const std::string &str) {
+				// Short strings are stored inside the string object itself.
+				return sizeof(std::string) <= str.capacity()? str.capacity() + 1 : 0;
+			}
+
+			/** Returns an estimate of the memory the line uses in bytes, including its cache of wrapped rows. */
+			virtual size_t memoryUsage() const {
+				return sizeof(*this) + breaks_.capacity() * sizeof(uint32_t) + heapUsage(text_);
 			}
 
 			/** Returns the number of blank spaces at the beginning of a row to use when the line's longer than the
@@ -64,6 +112,22 @@ namespace Haunted::UI {
 			 *  rows are. */
 			virtual size_t getContinuation() = 0;
 
+			/** Returns a pointer to the text if the line stores it, so that it doesn't have to be copied for caching.
+			 *  Lines that produce their text on demand return null. */
+			virtual const std::string * storedText() { return nullptr; }
+
+			/** Returns the part of the text on a given row for a given width, without the continuation or any padding.
+			 *  The view remains valid until the line is marked dirty. Rows only exist while wrapping is allowed. */
+			std::string_view rowView(ssize_t width, size_t row) {
+				clean(width);
+				if (dirty || breaks_.size() <= row)
+					return {};
+
+				const std::string_view text = cleanText();
+				const size_t start = breaks_[row], end = row + 1 < breaks_.size()? breaks_[row + 1] : text.size();
+				return text.substr(start, end - start);
+			}
+
 			/** Returns the text for a given row relative to the line for a given textbox width. */
 			virtual std::string textAtRow(size_t width, size_t row, bool pad_right = true) {
 				if (allowWrap && !*allowWrap) {
@@ -81,33 +145,20 @@ namespace Haunted::UI {
 					return text;
 				}
 
-				if (!dirty) {
-					return lines_[row];
-				} else if (!cleaning) {
-					clean(width);
-					return lines_[row];
-				}
-
 				auto w = formicine::perf.watch("TextLine::textAtRow");
-				const std::string text = std::string(*this);
-				const size_t text_length = ansi::length(text);
-
-				if (row == 0) {
-					return text_length < width? ansi::substr(text, 0, width) + std::string(width - text_length, ' ')
-						: ansi::substr(text, 0, width);
-				}
-
-				const size_t continuation = getContinuation();
-				const size_t index = continuation + row * (width - continuation);
-				if (index >= text_length)
+				clean(width);
+				if (ssize_t(row) >= numRows_)
 					return pad_right? std::string(width, ' ') : "";
 
-				std::string chunk = std::string(continuation, ' ') + ansi::substr(text, index, width - continuation);
-				const size_t chunk_length = ansi::length(chunk);
-				if (pad_right && chunk_length < width)
-					return chunk + std::string(width - chunk_length, ' ');
+				std::string out(row == 0? 0 : getContinuation(), ' ');
+				out += rowView(width, row);
+				if (pad_right) {
+					const size_t length = ansi::length(out);
+					if (length < width)
+						out.append(width - length, ' ');
+				}
 
-				return chunk;
+				return out;
 			}
 
 			/** Returns the number of rows the line will occupy for a given width. */
@@ -115,26 +166,13 @@ namespace Haunted::UI {
 				if (allowWrap && !*allowWrap)
 					return 1;
 
-				if (!dirty) {
-					return numRows_;
-				} else if (!cleaning) {
+				if (!cleaning)
 					clean(width);
+				if (!dirty)
 					return numRows_;
-				}
-
-				const std::string text = ansi::strip(*this);
-				// auto w = formicine::perf.watch("TextLine::numRows");
-
-				int length = ansi::length(text);
-				if (length <= width)
-					return 1;
 
-				// Ignore all the text on the first line because it's not affected by continuation.
-				length -= width;
-
-				const int continuation = getContinuation();
-				const int adjusted_continuation = width - (width == continuation? continuation - 1 : continuation);
-				return length / adjusted_continuation + (length % adjusted_continuation? 2 : 1);
+				const std::string *stored = storedText();
+				return countRows(ansi::length(stored? *stored : std::string(*this)), width, getContinuation());
 			}
 
 			/** Called when the line is clicked on. 
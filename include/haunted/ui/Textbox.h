@@ -1,16 +1,19 @@
 #pragma once
 
+#include <chrono>
 #include <deque>
 #include <functional>
 #include <list>
 #include <mutex>
 #include <string>
+#include <type_traits>
 #include <utility>
 
 #include "haunted/ui/ColoredControl.h"
 #include "haunted/core/Terminal.h"
 #include "haunted/core/Util.h"
 
+#include "haunted/ui/RowIndex.h"
 #include "haunted/ui/TextLine.h"
 #include "haunted/ui/SimpleLine.h"
 
@@ -44,10 +47,171 @@ namespace Haunted::UI {
 			/** Used for locking when doing operations on lines. */
 			std::recursive_mutex lineMutex;
 
-			std::unique_lock<std::recursive_mutex> lockLines() { return std::unique_lock(lineMutex); }
+			/** The number of rows each line occupies, kept up to date as lines are added so that finding the line at
+			 *  a row doesn't have to add up the rows of every line before it. Rebuilt after rowsDirty is called. */
+			RowIndex rowIndex;
+			bool rowIndexValid = false;
 
-			/** Empties the buffer and replaces it with 0-continuation lines from a vector of string. */
-			void setLines(const std::vector<std::string> &strings) {
+			/** Whether some lines may still have the row counts they had before the last change in width. Their
+			 *  counts in the row index serve as estimates until they're rewrapped. */
+			bool rewrapping = false;
+			/** The index of the next line to be rewrapped by rewrap. */
+			size_t rewrapCursor = 0;
+
+			/** The maximum number of lines and bytes of text to keep. Zero means there's no limit. */
+			size_t maxLines = 0, maxBytes = 0;
+
+			/** The number of bytes of text in each line, tracked only while there's a byte limit. */
+			std::deque<size_t> lineBytes;
+			size_t textBytes = 0;
+			bool bytesValid = false;
+
+			/** The number of lines evicted to stay within the scrollback limits. */
+			size_t evicted = 0;
+
+			std::unique_lock<std::recursive_mutex> lockLines() {
+				if (!terminal)
+					return std::unique_lock(lineMutex);
+				return terminal->metrics.lock(lineMutex, terminal->metrics.lineLock);
+			}
+
+			/** Rebuilds the row index if it's been invalidated. */
+			RowIndex & getRowIndex() {
+				if (!rowIndexValid) {
+					auto lock = lockLines();
+					rowIndex.clear();
+					rowIndex.reserve(lines.size());
+					for (const LinePtr &line: lines)
+						rowIndex.pushBack(lineRows(*line));
+					rowIndexValid = true;
+				}
+
+				return rowIndex;
+			}
+
+			/** Adds the most recently added line to the row index and the byte counts. */
+			void lineAdded() {
+				if (rowIndexValid)
+					rowIndex.pushBack(lineRows(*lines.back()));
+				if (maxBytes != 0 && bytesValid) {
+					lineBytes.push_back(std::string(*lines.back()).size());
+					textBytes += lineBytes.back();
+				}
+			}
+
+			/** Recounts the bytes of text in each line if the counts have been invalidated. */
+			void syncBytes() {
+				if (bytesValid)
+					return;
+
+				lineBytes.clear();
+				textBytes = 0;
+				for (const LinePtr &line: lines) {
+					lineBytes.push_back(std::string(*line).size());
+					textBytes += lineBytes.back();
+				}
+
+				bytesValid = true;
+			}
+
+			/** Removes the oldest lines until the textbox is within its scrollback limits, adjusting voffset so that
+			 *  the same lines stay in view. The newest line is never removed. Returns true if any of the removed lines
+			 *  were in view, in which case the textbox has to be redrawn. */
+			bool evict() {
+				if (maxLines == 0 && maxBytes == 0)
+					return false;
+
+				auto lock = lockLines();
+
+				// A deque can drop lines from the front in constant time, but a vector has to move every remaining
+				// line, so vectors drop an extra eighth of the limit at once to keep eviction amortized constant.
+				constexpr bool batch = !std::is_same_v<C<LinePtr>, std::deque<LinePtr>>;
+
+				size_t count = 0;
+				if (maxLines != 0 && maxLines < lines.size())
+					count = lines.size() - (batch? maxLines - maxLines / 8 : maxLines);
+
+				if (maxBytes != 0) {
+					syncBytes();
+					if (maxBytes < textBytes) {
+						const size_t target = batch? maxBytes - maxBytes / 8 : maxBytes;
+						size_t bytes = textBytes;
+						for (size_t i = 0; i < count; ++i)
+							bytes -= lineBytes[i];
+						while (target < bytes && count + 1 < lines.size())
+							bytes -= lineBytes[count++];
+					}
+				}
+
+				if (count == 0)
+					return false;
+
+				const size_t rows = allowWrap? getRowIndex().rowsBefore(count) : count;
+				if (rowIndexValid)
+					rowIndex.popFront(count);
+				rewrapCursor -= std::min(rewrapCursor, count);
+
+				if (maxBytes != 0) {
+					for (size_t i = 0; i < count; ++i) {
+						textBytes -= lineBytes.front();
+						lineBytes.pop_front();
+					}
+				}
+
+				lines.erase(lines.begin(), std::next(lines.begin(), count));
+				evicted += count;
+
+				const bool in_view = voffset < ssize_t(rows);
+				voffset = std::max(voffset - ssize_t(rows), ssize_t(0));
+				return in_view;
+			}
+
+			/** Replaces the row count of a line in the row index. If the line is entirely above the visible rows,
+			 *  voffset is adjusted so that the same rows stay in view. */
+			void correctRows(size_t index, size_t rows) {
+				const size_t old_rows = rowIndex.rows(index);
+				if (old_rows == rows)
+					return;
+
+				const bool above = ssize_t(rowIndex.rowsBefore(index) + old_rows) <= voffset;
+				rowIndex.set(index, rows);
+				if (above)
+					voffset += ssize_t(rows) - ssize_t(old_rows);
+			}
+
+			/** Starts rewrapping the lines for a new width. Only the lines from the top of the view to the bottom are
+			 *  rewrapped right away; the rest keep their old row counts as estimates until they're rewrapped by
+			 *  rewrap or on demand by lineAtRow. */
+			void beginRewrap(ssize_t old_width) {
+				auto lock = lockLines();
+				if (!allowWrap || !rowIndexValid || lines.empty())
+					return;
+
+				size_t top = lines.size(), top_offset = 0;
+				if (voffset < ssize_t(rowIndex.total()))
+					std::tie(top, top_offset) = rowIndex.find(voffset);
+
+				// Keep roughly the same part of the top line at the top of the view.
+				if (0 < position.width)
+					top_offset = top_offset * old_width / position.width;
+
+				ssize_t filled = -ssize_t(top_offset);
+				auto iter = std::next(lines.begin(), top);
+				for (size_t index = top; index < lines.size() && filled < position.height; ++index, ++iter) {
+					const size_t rows = lineRows(**iter);
+					rowIndex.set(index, rows);
+					filled += rows;
+				}
+
+				if (top < lines.size())
+					voffset = rowIndex.rowsBefore(top) + std::min(top_offset, rowIndex.rows(top) - 1);
+
+				rewrapping = true;
+				rewrapCursor = 0;
+			}
+
+			/** Empties the buffer and replaces it with 0-continuation lines from a container of strings. */
+			void setLines(const C<std::string> &strings) {
 				lines.clear();
 				for (const std::string &str: strings) {
 					std::shared_ptr<SimpleLine<C>> ptr = std::make_shared<SimpleLine<C>>(str, 0);
@@ -61,11 +225,12 @@ namespace Haunted::UI {
 			 *  scrolling the component and printing only the new line is sufficient.
 			 *  @param inserted Whether the line has already been inserted into the textbox's collection. */
 			void drawNewLine(TextLine<C> &line, bool inserted = false) {
-				if (!canDraw())
+				if (!canDraw() || requestDraw())
 					return;
 
 				auto lock = terminal->lockRender();
 				auto w = formicine::perf.watch("Textbox::drawNewLine");
+				Terminal::Frame frame(terminal);
 
 				const int new_lines = lineRows(line);
 				const int offset = inserted? new_lines : 0;
@@ -123,22 +288,22 @@ namespace Haunted::UI {
 				if (!allowWrap)
 					return {lines.at(row).get(), row};
 
-				size_t line_count = lines.size(), index = 0, row_count = 0, last_count = 0, offset = -1;
-
-				auto iter = lines.begin();
-				for (index = 0, row_count = 0; index < line_count; ++index) {
-					last_count = lineRows(**(iter++));
-					if (row_count <= row && row < row_count + last_count) {
-						offset = row - row_count;
-						break;
-					} else
-						row_count += last_count;
+				RowIndex &index = getRowIndex();
+				for (;;) {
+					const auto [line_index, offset] = index.find(row);
+					if (lines.size() <= line_index)
+						throw std::out_of_range("Line index too large: " + std::to_string(line_index));
+
+					// The line's row count may only be an estimate if it hasn't been rewrapped since a resize.
+					TextLine<C> *line = std::next(lines.begin(), line_index)->get();
+					const size_t rows = lineRows(*line);
+					if (!rewrapping || rows == index.rows(line_index))
+						return {line, offset};
+
+					correctRows(line_index, rows);
+					if (index.total() <= row)
+						throw std::out_of_range("Invalid row index: " + std::to_string(row));
 				}
-
-				if (line_count <= index)
-					throw std::out_of_range("Line index too large: " + std::to_string(index));
-
-				return {std::next(lines.begin(), index)->get(), offset == -1ul? row - row_count : offset};
 			}
 
 			/** Returns the string to print on a given row (zero-based) of the textbox. Handles text wrapping and
@@ -170,37 +335,30 @@ namespace Haunted::UI {
 					std::tie(line, offset) = lineAtRow(row + voffset);
 				}
 
-				const std::string line_text = *line;
-				const size_t continuation = line->getContinuation();
-
-				if (offset == 0) {
-					const size_t line_length = ansi::length(line_text);
-					if (pad_right)
-						return (ssize_t(line_length) <= cols? line_text + std::string(cols - line_length, ' ')
-							: ansi::substr(line_text, 0, cols)) + "\e[0m";
-					else
-						return (ssize_t(line_length) <= cols? line_text : ansi::substr(line_text, 0, cols)) + "\e[0m";
+				// The line's cached row breaks make it unnecessary to extract the row from the whole text.
+				std::string out(offset == 0? 0 : line->getContinuation(), ' ');
+				out.reserve(out.size() + cols + 4);
+				out += line->rowView(cols, offset);
+				if (pad_right) {
+					const ssize_t length = ansi::length(out);
+					if (length < cols)
+						out.append(cols - length, ' ');
 				}
 
-				// Number of chars visible per row on a continued line
-				const size_t continuation_chars = cols - continuation;
-
-				// Ignore the first line. 
-				std::string str = ansi::substr(line_text, cols);
+				out += "\e[0m";
+				return out;
+			}
 
-				// Erase the continued lines after the first line and before the continuation at the given row.
-				ansi::erase(str, 0, (offset - 1) * continuation_chars);
+			/** Limits a vertical offset to what vscroll allows for a given total number of rows. */
+			ssize_t limitVoffset(ssize_t wanted, ssize_t total) const {
+				ssize_t out = std::max(std::min(total - ssize_t(scrollBuffer), wanted), 0l);
 
-				// Erase all characters after the continuation if any remain.
-				if (continuation_chars < ansi::length(str))
-					ansi::erase(str, continuation_chars, std::string::npos);
+				// Don't let the voffset extend past the point where the (scrollBuffer + 1)th-last line of text is just
+				// above the first row.
+				if (position.height < total)
+					out = std::min(out, total - static_cast<int>(scrollBuffer));
 
-				const size_t str_length = ansi::length(str);
-				// Return the continuation padding plus the segment of text visible on the row.
-				if (pad_right && ssize_t(continuation + str_length) < cols)
-					return std::string(continuation, ' ') + str + std::string(cols - continuation - str_length, ' ') +
-						"\e[0m";
-				return std::string(continuation, ' ') + str + "\e[0m";
+				return out;
 			}
 
 			/** Performs vertical scrolling for a given number of rows if autoscrolling is enabled and the right
@@ -215,10 +373,45 @@ namespace Haunted::UI {
 				return false;
 			}
 
-		public:
-			/** The cached return value of total_rows(). */
-			int totalRows_ = -1;
+			/** Draws the visible rows. */
+			void drawRows() {
+				auto w = formicine::perf.watch("Textbox::draw");
+				auto lock = terminal->lockRender();
+				auto line_lock = lockLines();
+				auto timer = terminal->metrics.timeDraw(this);
+				Terminal::Frame frame(terminal);
+
+				tryMargins([&, this]() {
+					terminal->hide();
+					clearRect();
+					applyColors();
+
+					if (0 <= voffset && ssize_t(totalRows()) <= voffset) {
+						// There's no need to draw anything if the box has been scrolled down beyond all its contents.
+					} else {
+						try {
+							std::string text {};
+							text.reserve(position.height * position.width);
+							for (int i = 0; i < position.height; ++i) {
+								if (i != 0)
+									text.push_back('\n');
+								text += textAtRow(i, false);
+							}
+
+							terminal->jump(0, 0);
+							*terminal << text;
+							applyColors();
+						} catch (const std::out_of_range &) {}
+					}
+					
+					uncolor();
+					terminal->show();
+				});
+
+				terminal->jumpToFocused();
+			}
 
+		public:
 			/** The minimum number of lines that must be visible at the top. */
 			unsigned int scrollBuffer = 0;
 
@@ -226,9 +419,19 @@ namespace Haunted::UI {
 			 *  better. */
 			bool allowWrap = true;
 
-			/** Marks the cached return value of total_rows() as dirty. */
+			/** The longest each draw spends rewrapping lines outside the view after the width changes. The rewrapping
+			 *  happens after the frame has been committed and the locks taken for drawing have been released. Zero
+			 *  leaves it to the application. */
+			std::chrono::microseconds rewrapTime {1000};
+
+			/** The number of lines rewrapFor rewraps at a time, which bounds how long it keeps the lines locked. */
+			size_t rewrapBatch = 256;
+
+			/** Marks the row counts of the lines as dirty. This has to be called after modifying the lines directly. */
 			void rowsDirty() {
-				totalRows_ = -1;
+				rowIndexValid = false;
+				bytesValid = false;
+				rewrapping = false;
 			}
 
 			/** Marks the num_rows_ values of the contained lines as dirty. */
@@ -250,8 +453,9 @@ namespace Haunted::UI {
 				if (parent_)
 					parent_->addChild(this);
 				setLines(contents_);
-				// addChild could modify the position, so we set the position again at the end to overoverwrite it.
-				position = pos_;
+				// addChild could modify the position, so we set the position again at the end to overoverwrite it. It's
+				// set through Control::resize so that containers know the layout changed.
+				Control::resize(pos_);
 			}
 
 			Textbox(Container *parent_, bool allow_wrap, const C<std::string> &contents_ = {}):
@@ -272,6 +476,32 @@ namespace Haunted::UI {
 
 			C<LinePtr> & getLines() { return lines; }
 
+			/** Limits the scrollback to a number of lines, a number of bytes of text or both. Once either limit is
+			 *  exceeded, the oldest lines are evicted. Zero means there's no limit. */
+			void setScrollback(size_t max_lines, size_t max_bytes = 0) {
+				maxLines = max_lines;
+				maxBytes = max_bytes;
+				bytesValid = false;
+				if (evict())
+					draw();
+			}
+
+			size_t getMaxLines() const { return maxLines; }
+			size_t getMaxBytes() const { return maxBytes; }
+
+			/** Returns the number of lines evicted so far to stay within the scrollback limits. */
+			size_t getEvicted() const { return evicted; }
+
+			/** Returns an estimate of the memory used by the textbox and its lines in bytes. This takes time
+			 *  proportional to the number of lines. */
+			size_t memoryUsage() {
+				auto lock = lockLines();
+				size_t out = sizeof(*this) + rowIndex.memoryUsage() + lineBytes.size() * sizeof(size_t);
+				for (const LinePtr &line: lines)
+					out += sizeof(LinePtr) + line->memoryUsage();
+				return out;
+			}
+
 			/** Scrolls the textbox down (positive argument) or up (negative argument). */
 			void vscroll(ssize_t delta = 1) {
 				auto w = formicine::perf.watch("Textbox::vscroll");
@@ -279,17 +509,13 @@ namespace Haunted::UI {
 				const ssize_t total = totalRows();
 				const ssize_t old_voffset = voffset;
 
-				voffset = std::max(std::min(total - ssize_t(scrollBuffer), voffset + delta), 0l);
-
-				// Don't let the voffset extend past the point where the (scrollBuffer + 1)th-last line of text is just
-				// above the first row.
-				if (position.height < total)
-					voffset = std::min(voffset, total - static_cast<int>(scrollBuffer));
+				voffset = limitVoffset(voffset + delta, total);
 
-				if (!canDraw())
+				if (!canDraw() || requestDraw())
 					return;
 
 				auto lock = terminal->lockRender();
+				Terminal::Frame frame(terminal);
 				ssize_t diff = old_voffset - voffset;
 
 				tryMargins([&, this]() {
@@ -362,14 +588,7 @@ namespace Haunted::UI {
 				if (!allowWrap)
 					return lines.size();
 
-				if (totalRows_ != -1)
-					return totalRows_;
-
-				totalRows_ = 0;
-				for (const LinePtr &line: lines)
-					totalRows_ += lineRows(*line);
-
-				return totalRows_;
+				return getRowIndex().total();
 			}
 
 			/** Draws the textbox on the terminal. */
@@ -377,46 +596,52 @@ namespace Haunted::UI {
 				if (!canDraw())
 					return;
 
-				auto w = formicine::perf.watch("Textbox::draw");
-				auto lock = terminal->lockRender();
-				auto line_lock = lockLines();
+				drawRows();
+				// Lines outside the view can be rewrapped now that the visible ones are on the screen and nothing is
+				// waiting on the locks drawRows took.
+				if (rewrapping && 0 < rewrapTime.count())
+					rewrapFor(rewrapTime);
+			}
 
-				tryMargins([&, this]() {
-					terminal->hide();
-					clearRect();
-					applyColors();
+			/** Resizes the textbox to fit a new position. */
+			void resize(const Haunted::Position &new_pos) override {
+				const ssize_t old_width = position.width;
+				ColoredControl::resize(new_pos);
+				// Lines rewrap themselves when they're next used at a different width, so they don't need to be
+				// marked as dirty, and a change in height doesn't affect wrapping at all.
+				if (position.width != old_width)
+					beginRewrap(old_width);
+			}
 
-					if (0 <= voffset && ssize_t(totalRows()) <= voffset) {
-						// There's no need to draw anything if the box has been scrolled down beyond all its contents.
-					} else {
-						try {
-							std::string text {};
-							text.reserve(position.height * position.width);
-							for (int i = 0; i < position.height; ++i) {
-								if (i != 0)
-									text.push_back('\n');
-								text += textAtRow(i, false);
-							}
+			/** Rewraps up to a given number of lines that haven't been rewrapped since the width last changed,
+			 *  correcting their row counts. Returns whether any lines remain. */
+			bool rewrap(size_t budget) {
+				auto lock = lockLines();
+				if (!rewrapping || !rowIndexValid)
+					return rewrapping = false;
 
-							terminal->jump(0, 0);
-							*terminal << text;
-							applyColors();
-						} catch (const std::out_of_range &) {}
-					}
-					
-					uncolor();
-					terminal->show();
-				});
+				auto iter = std::next(lines.begin(), rewrapCursor);
+				for (; 0 < budget && rewrapCursor < lines.size(); --budget, ++rewrapCursor, ++iter)
+					correctRows(rewrapCursor, lineRows(**iter));
 
-				terminal->jumpToFocused();
+				return rewrapping = rewrapCursor < lines.size();
 			}
 
-			/** Resizes the textbox to fit a new position. */
-			void resize(const Haunted::Position &new_pos) override {
-				ColoredControl::resize(new_pos);
-				markDirty();
+			/** Rewraps lines rewrapBatch at a time until none remain or a given amount of time has passed, locking
+			 *  the lines only for one batch at a time. Returns whether any lines remain. draw calls this with
+			 *  rewrapTime; applications can also call it when idle (from a timer on the terminal's event loop, for
+			 *  example) to finish sooner. */
+			bool rewrapFor(std::chrono::nanoseconds duration) {
+				const auto deadline = std::chrono::steady_clock::now() + duration;
+				while (std::chrono::steady_clock::now() < deadline)
+					if (!rewrap(rewrapBatch))
+						return false;
+				return rewrapping;
 			}
 
+			/** Returns whether some row counts are still estimates after a change in width. */
+			bool isRewrapping() const { return rewrapping; }
+
 			/** Handles keyboard input. */
 			bool onKey(const Key &key) override {
 				return keyFunction? keyFunction(key) : defaultOnKey(key);
@@ -425,10 +650,10 @@ namespace Haunted::UI {
 			/** Calls the clicked textline's onMouse method. */
 			bool onMouse(const MouseReport &report) override {
 				if (report.action == MouseAction::ScrollUp) {
-					vscroll(-1);
+					vscroll(-report.count);
 					return true;
 				} else if (report.action == MouseAction::ScrollDown) {
-					vscroll(1);
+					vscroll(report.count);
 					return true;
 				}
 
@@ -476,23 +701,31 @@ namespace Haunted::UI {
 			}
 
 			void redrawLine(TextLine<C> &to_redraw) {
-				if (!canDraw())
+				if (!canDraw() || requestDraw())
 					return;
 
-				ssize_t rows = 0;
 				auto lock = lockLines();
-				for (LinePtr &line: lines) {
+				size_t index = 0;
+				for (const LinePtr &line: lines) {
 					if (line.get() == &to_redraw)
 						break;
-					rows += lineRows(*line);
+					++index;
 				}
 
+				if (lines.size() <= index)
+					return;
+
+				const ssize_t rows = allowWrap? getRowIndex().rowsBefore(index) : index;
 				ssize_t next = rows - voffset;
 				if (voffset <= rows && next < position.height) {
 					// The line is in view.
 					to_redraw.markDirty();
 					to_redraw.clean(position.width);
 					const ssize_t new_lines = ssize_t(lineRows(to_redraw));
+					// The line may wrap differently now.
+					if (rowIndexValid)
+						correctRows(index, new_lines);
+					Terminal::Frame frame(terminal);
 					tryMargins([this, &to_redraw, next, new_lines]() {
 						applyColors();
 
@@ -517,11 +750,15 @@ namespace Haunted::UI {
 				std::shared_ptr<SimpleLine<C>> ptr = std::make_shared<SimpleLine<C>>(text, 0, &allowWrap);
 				auto lock = lockLines();
 				lines.push_back(std::move(ptr));
-				rowsDirty();
+				lineAdded();
+				const bool in_view = evict();
 				if (canDraw()) {
 					if (autoscroll)
 						doScroll(lines.back()->numRows(position.width));
-					drawNewLine(*lines.back(), true);
+					if (in_view)
+						draw();
+					else
+						drawNewLine(*lines.back(), true);
 				}
 				return *this;
 			}
@@ -535,12 +772,64 @@ namespace Haunted::UI {
 				if (canDraw() && autoscroll)
 					doScroll(line_copy->numRows(position.width));
 				lines.push_back(std::move(line_copy));
-				rowsDirty();
-				if (canDraw())
-					drawNewLine(*lines.back(), true);
+				lineAdded();
+				const bool in_view = evict();
+				if (canDraw()) {
+					if (in_view)
+						draw();
+					else
+						drawNewLine(*lines.back(), true);
+				}
 				return *this;
 			}
 
+			/** Adds a range of lines to the end of the textbox at once. The elements can be strings or line pointers.
+			 *  Autoscrolling ends up where it would have if the lines had been added one at a time, but they're all
+			 *  added under a single lock and only the final visible rows are drawn, once. */
+			template <typename R>
+			Textbox & append(const R &range) {
+				auto w = formicine::perf.watch("Textbox::append");
+
+				{
+					auto lock = lockLines();
+					if constexpr (std::is_same_v<C<LinePtr>, std::vector<LinePtr>>)
+						lines.reserve(lines.size() + std::distance(std::begin(range), std::end(range)));
+
+					const bool scrolling = autoscroll && canDraw();
+					ssize_t total = scrolling? totalRows() : 0;
+
+					for (const auto &item: range) {
+						if constexpr (std::is_convertible_v<decltype(item), std::string>) {
+							lines.push_back(std::make_shared<SimpleLine<C>>(item, 0, &allowWrap));
+						} else {
+							lines.push_back(item);
+							lines.back()->box = this;
+						}
+
+						lineAdded();
+
+						// Follow the new lines the same way doScroll would have after each one.
+						if (scrolling) {
+							const ssize_t rows = lineRows(*lines.back());
+							total += rows;
+							if (position.height == total - voffset)
+								voffset = limitVoffset(voffset + rows, total);
+						}
+					}
+
+					evict();
+				}
+
+				if (canDraw() && !requestDraw())
+					draw();
+				return *this;
+			}
+
+			/** Adds a batch of strings to the end of the textbox at once. Unlike append, this accepts a braced list. */
+			Textbox & appendBatch(const std::vector<std::string> &texts) {
+				return append(texts);
+			}
+
 			/** Returns the textbox's contents. */
 			operator std::string() {
 				auto w = formicine::perf.watch("Textbox::operator std::string");
@@ -567,6 +856,9 @@ namespace Haunted::UI {
 				std::swap(left.voffset,      right.voffset);
 				std::swap(left.autoscroll,   right.autoscroll);
 				std::swap(left.scrollBuffer, right.scrollBuffer);
+				std::swap(left.maxLines,     right.maxLines);
+				std::swap(left.maxBytes,     right.maxBytes);
+				std::swap(left.evicted,      right.evicted);
 				left.markDirty();
 				right.markDirty();
 			}
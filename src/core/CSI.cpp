@@ -87,46 +87,55 @@ namespace Haunted {
 	}
 
 	Key CSI::getKey() const {
+		Key out;
+		if (tryGetKey(out))
+			return out;
+		if (suffix == '~')
+			throw std::invalid_argument("Unexpected special key: " + std::to_string(first));
+		throw std::invalid_argument("Unexpected suffix: '" + std::string(1, suffix) + "'");
+	}
+
+	bool CSI::tryGetKey(Key &out) const {
 		switch (suffix) {
-			case 'A': return KeyType::UpArrow;
-			case 'B': return KeyType::DownArrow;
-			case 'C': return KeyType::RightArrow;
-			case 'D': return KeyType::LeftArrow;
-			case 'F': return KeyType::End;
-			case 'H': return KeyType::Home;
-			case 'P': return KeyType::F1;
-			case 'Q': return KeyType::F2;
-			case 'R': return KeyType::F3;
-			case 'S': return KeyType::F4;
-			case 'Z': return Key(KeyType::Tab).shift();
-			case 'u': return KeyType(first);
+			case 'A': out = KeyType::UpArrow;    return true;
+			case 'B': out = KeyType::DownArrow;  return true;
+			case 'C': out = KeyType::RightArrow; return true;
+			case 'D': out = KeyType::LeftArrow;  return true;
+			case 'F': out = KeyType::End;  return true;
+			case 'H': out = KeyType::Home; return true;
+			case 'P': out = KeyType::F1; return true;
+			case 'Q': out = KeyType::F2; return true;
+			case 'R': out = KeyType::F3; return true;
+			case 'S': out = KeyType::F4; return true;
+			case 'Z': out = Key(KeyType::Tab).shift(); return true;
+			case 'u': out = KeyType(first); return true;
 			case '~':
 				switch (first) {
-					case 2:  return KeyType::Insert;
-					case 3:  return KeyType::Del;
+					case 2:  out = KeyType::Insert; return true;
+					case 3:  out = KeyType::Del;    return true;
 					case 147:
-					case 5:  return KeyType::PageUp;
+					case 5:  out = KeyType::PageUp;   return true;
 					case 148:
-					case 6:  return KeyType::PageDown;
+					case 6:  out = KeyType::PageDown; return true;
 					case 1:
-					case 7:  return KeyType::Home;
+					case 7:  out = KeyType::Home; return true;
 					case 4:
-					case 8:  return KeyType::End;
-					case 11: return KeyType::F1;
-					case 12: return KeyType::F2;
-					case 13: return KeyType::F3;
-					case 14: return KeyType::F4;
-					case 15: return KeyType::F5;
-					case 17: return KeyType::F6;
-					case 18: return KeyType::F7;
-					case 19: return KeyType::F8;
-					case 20: return KeyType::F9;
-					case 21: return KeyType::F10;
-					case 23: return KeyType::F11;
-					case 24: return KeyType::F12;
-					default: throw std::invalid_argument("Unexpected special key: " + std::to_string(first));
+					case 8:  out = KeyType::End;  return true;
+					case 11: out = KeyType::F1;  return true;
+					case 12: out = KeyType::F2;  return true;
+					case 13: out = KeyType::F3;  return true;
+					case 14: out = KeyType::F4;  return true;
+					case 15: out = KeyType::F5;  return true;
+					case 17: out = KeyType::F6;  return true;
+					case 18: out = KeyType::F7;  return true;
+					case 19: out = KeyType::F8;  return true;
+					case 20: out = KeyType::F9;  return true;
+					case 21: out = KeyType::F10; return true;
+					case 23: out = KeyType::F11; return true;
+					case 24: out = KeyType::F12; return true;
+					default: return false;
 				}
-			default: throw std::invalid_argument("Unexpected suffix: '" + std::string(1, suffix) + "'");
+			default: return false;
 		}
 	}
 	
@@ -0,0 +1,202 @@
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "haunted/core/EventLoop.h"
+
+namespace Haunted {
+	EventLoop::EventLoop() {
+		epollFd = epoll_create1(EPOLL_CLOEXEC);
+		if (epollFd < 0)
+			throw std::runtime_error("epoll_create1 failed: " + std::string(std::strerror(errno)));
+
+		wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if (wakeFd < 0) {
+			::close(epollFd);
+			throw std::runtime_error("eventfd failed: " + std::string(std::strerror(errno)));
+		}
+
+		watch(wakeFd, EPOLLIN, [this](uint32_t) {
+			uint64_t count;
+			while (::read(wakeFd, &count, sizeof(count)) == sizeof(count));
+			runPosted();
+		});
+	}
+
+	EventLoop::~EventLoop() {
+		// Descriptors registered with watch belong to whoever registered them, but the rest are the loop's own.
+		for (const auto &[signal, fd]: signalFds)
+			::close(fd);
+		for (const int fd: timerFds)
+			::close(fd);
+		::close(wakeFd);
+		::close(epollFd);
+	}
+
+
+// Private instance methods
+
+
+	void EventLoop::runPosted() {
+		std::vector<std::function<void()>> to_run;
+		{
+			std::unique_lock<std::mutex> lock(postMutex);
+			to_run.swap(posted);
+		}
+
+		for (auto &function: to_run)
+			function();
+	}
+
+
+// Public instance methods
+
+
+	void EventLoop::watch(int fd, uint32_t events, Callback callback) {
+		epoll_event event {};
+		event.events = events;
+		event.data.fd = fd;
+
+		const bool existing = callbacks.count(fd) != 0;
+		if (epoll_ctl(epollFd, existing? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &event) < 0)
+			throw std::runtime_error("epoll_ctl failed for fd " + std::to_string(fd) + ": " + std::strerror(errno));
+
+		callbacks[fd] = std::make_shared<Callback>(std::move(callback));
+	}
+
+	void EventLoop::unwatch(int fd) {
+		if (callbacks.erase(fd) != 0)
+			epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+	}
+
+	int EventLoop::addTimer(std::chrono::nanoseconds delay, std::chrono::nanoseconds interval,
+	                        std::function<void()> function) {
+		const int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+		if (fd < 0)
+			throw std::runtime_error("timerfd_create failed: " + std::string(std::strerror(errno)));
+
+		auto to_timespec = [](std::chrono::nanoseconds duration) {
+			return timespec {time_t(duration.count() / 1'000'000'000), long(duration.count() % 1'000'000'000)};
+		};
+
+		itimerspec spec {to_timespec(interval), to_timespec(delay)};
+		// A zero delay would disarm the timer instead of firing it immediately.
+		if (spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0)
+			spec.it_value.tv_nsec = 1;
+
+		if (timerfd_settime(fd, 0, &spec, nullptr) < 0) {
+			::close(fd);
+			throw std::runtime_error("timerfd_settime failed: " + std::string(std::strerror(errno)));
+		}
+
+		timerFds.insert(fd);
+		const bool repeating = interval.count() != 0;
+		watch(fd, EPOLLIN, [this, fd, repeating, function = std::move(function)](uint32_t) {
+			uint64_t expirations;
+			if (::read(fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+				return;
+			if (!repeating)
+				cancelTimer(fd);
+			function();
+		});
+
+		return fd;
+	}
+
+	void EventLoop::cancelTimer(int id) {
+		if (timerFds.erase(id) == 0)
+			return;
+		unwatch(id);
+		::close(id);
+	}
+
+	void EventLoop::watchSignal(int signal, std::function<void()> function) {
+		unwatchSignal(signal);
+
+		sigset_t mask;
+		sigemptyset(&mask);
+		sigaddset(&mask, signal);
+		pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+
+		const int fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+		if (fd < 0)
+			throw std::runtime_error("signalfd failed: " + std::string(std::strerror(errno)));
+
+		signalFds[signal] = fd;
+		watch(fd, EPOLLIN, [fd, function = std::move(function)](uint32_t) {
+			signalfd_siginfo info;
+			bool received = false;
+			while (::read(fd, &info, sizeof(info)) == sizeof(info))
+				received = true;
+			// Several deliveries of the same signal between two iterations of the loop are handled once.
+			if (received)
+				function();
+		});
+	}
+
+	void EventLoop::unwatchSignal(int signal) {
+		auto iter = signalFds.find(signal);
+		if (iter == signalFds.end())
+			return;
+
+		unwatch(iter->second);
+		::close(iter->second);
+		signalFds.erase(iter);
+
+		sigset_t mask;
+		sigemptyset(&mask);
+		sigaddset(&mask, signal);
+		pthread_sigmask(SIG_UNBLOCK, &mask, nullptr);
+	}
+
+	void EventLoop::post(std::function<void()> function) {
+		{
+			std::unique_lock<std::mutex> lock(postMutex);
+			posted.push_back(std::move(function));
+		}
+
+		const uint64_t one = 1;
+		[[maybe_unused]] ssize_t result = ::write(wakeFd, &one, sizeof(one));
+	}
+
+	int EventLoop::runOnce(int timeout_ms) {
+		epoll_event events[64];
+		const int count = epoll_wait(epollFd, events, 64, timeout_ms);
+		if (count < 0) {
+			if (errno == EINTR)
+				return 0;
+			throw std::runtime_error("epoll_wait failed: " + std::string(std::strerror(errno)));
+		}
+
+		for (int i = 0; i < count; ++i) {
+			// An earlier callback may have unwatched this descriptor.
+			auto iter = callbacks.find(events[i].data.fd);
+			if (iter == callbacks.end())
+				continue;
+			std::shared_ptr<Callback> callback = iter->second;
+			(*callback)(events[i].events);
+		}
+
+		return count;
+	}
+
+	void EventLoop::run() {
+		running = true;
+		while (running)
+			runOnce();
+	}
+
+	void EventLoop::stop() {
+		running = false;
+		const uint64_t one = 1;
+		[[maybe_unused]] ssize_t result = ::write(wakeFd, &one, sizeof(one));
+	}
+}
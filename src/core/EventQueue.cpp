@@ -0,0 +1,77 @@
+#include "haunted/core/EventQueue.h"
+
+namespace Haunted {
+	EventQueue::EventQueue(size_t capacity) {
+		size_t size = 2;
+		while (size < capacity)
+			size <<= 1;
+
+		slots = std::make_unique<Slot[]>(size);
+		mask = size - 1;
+	}
+
+
+// Public instance methods
+
+
+	bool EventQueue::tryPush(InputDecoder::Event &&event) {
+		const size_t position = head.load(std::memory_order_relaxed);
+		const size_t waiting = position - tail.load(std::memory_order_acquire);
+		if (mask < waiting)
+			return false;
+
+		Slot &slot = slots[position & mask];
+		slot.event = std::move(event);
+		slot.queued = std::chrono::steady_clock::now();
+		head.store(position + 1, std::memory_order_release);
+
+		if (maxDepth.load(std::memory_order_relaxed) <= waiting)
+			maxDepth.store(waiting + 1, std::memory_order_relaxed);
+
+		wake();
+		return true;
+	}
+
+	bool EventQueue::push(InputDecoder::Event &&event, const std::atomic<bool> &keep_going) {
+		if (tryPush(std::move(event)))
+			return true;
+
+		stalls.fetch_add(1, std::memory_order_relaxed);
+		for (;;) {
+			// Read the epoch before checking again so a pop in between isn't missed.
+			const uint32_t old_epoch = popped.load(std::memory_order_acquire);
+			if (tryPush(std::move(event)))
+				return true;
+			if (!keep_going)
+				return false;
+			popped.wait(old_epoch, std::memory_order_acquire);
+		}
+	}
+
+	bool EventQueue::tryPop(InputDecoder::Event &out) {
+		const size_t position = tail.load(std::memory_order_relaxed);
+		if (position == head.load(std::memory_order_acquire))
+			return false;
+
+		Slot &slot = slots[position & mask];
+		out = std::move(slot.event);
+		latency.record(std::chrono::steady_clock::now() - slot.queued);
+		tail.store(position + 1, std::memory_order_release);
+		wakeProducer();
+		return true;
+	}
+
+	size_t EventQueue::depth() const {
+		return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+	}
+
+	void EventQueue::wake() {
+		pushed.fetch_add(1, std::memory_order_release);
+		pushed.notify_one();
+	}
+
+	void EventQueue::wakeProducer() {
+		popped.fetch_add(1, std::memory_order_release);
+		popped.notify_one();
+	}
+}
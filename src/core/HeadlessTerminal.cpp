@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+#include "haunted/core/HeadlessTerminal.h"
+
+namespace Haunted {
+	HeadlessTerminal::HeadlessTerminal(int cols_, int rows_):
+	Terminal(input, outputStream, rows_, cols_), screen(cols_, rows_) {}
+
+
+// Private instance methods
+
+
+	void HeadlessTerminal::sync() {
+		const std::string pending = output.str();
+		if (pending.empty())
+			return;
+		output.str("");
+		consume(pending, totalStats);
+	}
+
+	void HeadlessTerminal::consume(const std::string &data, Stats &stats) {
+		stats.bytes += data.size();
+		stats.sequences += std::count(data.begin(), data.end(), '\e');
+		screen.feed(data);
+	}
+
+
+// Protected instance methods
+
+
+	size_t HeadlessTerminal::writeOutput(std::string data) {
+		sync();
+		lastStats = {};
+		lastStats.frames = 1;
+		if (0 < frameNesting)
+			lastStats.elapsed = std::chrono::steady_clock::now() - frameStart;
+		consume(data, lastStats);
+
+		totalStats.frames += lastStats.frames;
+		totalStats.bytes += lastStats.bytes;
+		totalStats.sequences += lastStats.sequences;
+		totalStats.elapsed += lastStats.elapsed;
+		return 1;
+	}
+
+
+// Public instance methods
+
+
+	void HeadlessTerminal::beginFrame() {
+		if (frameNesting++ == 0)
+			frameStart = std::chrono::steady_clock::now();
+		Terminal::beginFrame();
+	}
+
+	void HeadlessTerminal::commitFrame() {
+		Terminal::commitFrame();
+		--frameNesting;
+	}
+
+	void HeadlessTerminal::setSize(int cols_, int rows_) {
+		sync();
+		screen.resize(cols_, rows_);
+		winch(rows_, cols_);
+	}
+
+	const Screen & HeadlessTerminal::getScreen() {
+		sync();
+		return screen;
+	}
+
+	std::string HeadlessTerminal::dump() {
+		sync();
+		std::string out;
+		for (int y = 0; y < screen.getHeight(); ++y)
+			out += screen.rowText(y) + "\n";
+		return out;
+	}
+
+	bool HeadlessTerminal::matchesGolden(const std::string &path, bool update) {
+		const std::string contents = dump();
+
+		std::ifstream in(path);
+		if (in.is_open() && !update) {
+			std::stringstream golden;
+			golden << in.rdbuf();
+			if (in.bad())
+				throw std::runtime_error("Couldn't read golden file " + path);
+			return golden.str() == contents;
+		}
+
+		std::ofstream out(path);
+		if (!(out << contents))
+			throw std::runtime_error("Couldn't write golden file " + path);
+		return true;
+	}
+
+	void HeadlessTerminal::resetStats() {
+		lastStats = totalStats = {};
+	}
+}
@@ -0,0 +1,238 @@
+#include <algorithm>
+
+#include "haunted/core/CSI.h"
+#include "haunted/core/InputDecoder.h"
+
+namespace Haunted {
+	using uchar = unsigned char;
+
+	const std::array<InputDecoder::ByteClass, 256> InputDecoder::classes = [] {
+		std::array<ByteClass, 256> out {};
+		for (size_t i = 0; i < out.size(); ++i) {
+			if (i == 0x1b)
+				out[i] = ByteClass::Escape;
+			else if (i < 0x20)
+				out[i] = ByteClass::Control;
+			else if (i < 0x30)
+				out[i] = ByteClass::Intermediate;
+			else if (i <= '9')
+				out[i] = ByteClass::Digit;
+			else if (i == ':')
+				out[i] = ByteClass::Colon;
+			else if (i == ';')
+				out[i] = ByteClass::Separator;
+			else if (i < 0x40)
+				out[i] = ByteClass::Marker;
+			else if (i < 0x7f)
+				out[i] = ByteClass::Final;
+			else
+				out[i] = ByteClass::Other;
+		}
+
+		return out;
+	}();
+
+
+// Private static methods
+
+
+	Key InputDecoder::groundKey(char ch) {
+		switch (ch) {
+			case 9:  return KeyType::Tab;
+			case 10: return KeyType::Enter;
+			case 13: return KeyType::CarriageReturn;
+		}
+
+		// 1..26 corresponds to ^a..^z.
+		if (0 < ch && ch < 27)
+			return {uchar(KeyType::a) + ch - 1, KeyMod::Ctrl};
+
+		return ch;
+	}
+
+
+// Private instance methods
+
+
+	void InputDecoder::beginCSI() {
+		params.fill(0);
+		paramCount = 0;
+		marker = 0;
+		skippingSubparam = false;
+	}
+
+	void InputDecoder::dispatchCSI(char final_char, std::vector<Event> &out) {
+		// Bracketed paste mode surrounds pasted text with "CSI 200 ~" and "CSI 201 ~".
+		if (marker == 0 && final_char == '~' && paramCount == 1 && params[0] == 200) {
+			pasteBuffer.clear();
+			state = State::Paste;
+			return;
+		}
+
+		if (marker == '<') {
+			// SGR mouse reports look like "CSI < button ; x ; y M" (or m for releases).
+			if ((final_char == 'M' || final_char == 'm') && paramCount == 3)
+				out.emplace_back(std::in_place_type<MouseReport>, long(params[0]), final_char, long(params[1]) - 1,
+					long(params[2]) - 1);
+			return;
+		}
+
+		// Other private sequences aren't keys, and neither is anything that isn't recognized.
+		if (marker != 0)
+			return;
+
+		const unsigned int first  = 0 < paramCount && params[0] != 0? params[0] : 1;
+		const unsigned int second = 1 < paramCount && params[1] != 0? params[1] : 1;
+
+		Key key;
+		if (!CSI(first, second, final_char).tryGetKey(key))
+			return;
+
+		// Some keys come with modifiers already set. For example, ^[Z represents shift+tab. If these modifiers are
+		// already set, then modifiers weren't specified the CSI u way and we shouldn't change them.
+		if (key.mods.none())
+			key = Key(key.type, ModSet((second - 1) & 7));
+
+		out.emplace_back(key);
+	}
+
+
+	size_t InputDecoder::feedPaste(std::string_view input, std::vector<Event> &out) {
+		static constexpr std::string_view terminator = "\e[201~";
+
+		// The terminator may have been split across chunks, so look for it starting with whatever part of it might
+		// already be at the end of the buffer.
+		const size_t carried = std::min(pasteBuffer.size(), terminator.size() - 1);
+		pasteBuffer.append(input);
+		const size_t end = pasteBuffer.find(terminator, pasteBuffer.size() - input.size() - carried);
+		if (end == std::string::npos)
+			return input.size();
+
+		const size_t consumed = end + terminator.size() - (pasteBuffer.size() - input.size());
+		pasteBuffer.resize(end);
+		out.emplace_back(Paste {std::move(pasteBuffer)});
+		pasteBuffer.clear();
+		state = State::Ground;
+		return consumed;
+	}
+
+
+// Public instance methods
+
+
+	void InputDecoder::feed(std::string_view input, std::vector<Event> &out) {
+		for (size_t i = 0; i < input.size(); ++i) {
+			// Pasted text is copied in bulk rather than decoded byte by byte.
+			if (state == State::Paste) {
+				i += feedPaste(input.substr(i), out) - 1;
+				continue;
+			}
+
+			const char ch = input[i];
+
+			if (raw) {
+				out.emplace_back(Key(ch));
+				continue;
+			}
+
+			const ByteClass byte_class = classes[uchar(ch)];
+
+			switch (state) {
+				case State::Ground:
+					if (byte_class == ByteClass::Escape)
+						state = State::Escape;
+					else
+						out.emplace_back(groundKey(ch));
+					break;
+
+				case State::Escape:
+					// We can't tell the difference between an actual press of the escape key and the beginning of a
+					// sequence until more input arrives; if none does, flush turns the escape into a key. A second
+					// escape means the first was a key press, and the second may still begin a sequence of its own.
+					if (byte_class == ByteClass::Escape) {
+						out.emplace_back(Key(KeyType::Escape));
+					} else if (ch == '[') {
+						beginCSI();
+						state = State::CSIStart;
+					} else {
+						out.emplace_back(Key(ch, KeyMod::Alt));
+						state = State::Ground;
+					}
+					break;
+
+				case State::CSIStart:
+					// A lone Alt+[ is resolved by flush. Alt+[ followed quickly by [ or another escape still can't be
+					// told apart from a sequence, so we assume the user typed an actual Alt+[ and then began another
+					// sequence.
+					if (ch == '[' || byte_class == ByteClass::Escape) {
+						out.emplace_back(Key('[', KeyMod::Alt));
+						state = ch == '['? State::Ground : State::Escape;
+						break;
+					}
+
+					state = State::CSI;
+					if (byte_class == ByteClass::Marker) {
+						marker = ch;
+						break;
+					}
+					[[fallthrough]];
+
+				case State::CSI:
+					switch (byte_class) {
+						case ByteClass::Digit:
+							if (skippingSubparam)
+								break;
+							if (paramCount == 0)
+								paramCount = 1;
+							if (unsigned int &param = params[paramCount - 1]; param < 100'000)
+								param = param * 10 + (ch - '0');
+							break;
+						case ByteClass::Separator:
+							skippingSubparam = false;
+							if (paramCount == 0)
+								paramCount = 1;
+							if (paramCount < maxParams)
+								++paramCount;
+							break;
+						case ByteClass::Colon:
+							skippingSubparam = true;
+							break;
+						case ByteClass::Final:
+							state = State::Ground;
+							dispatchCSI(ch, out);
+							break;
+						case ByteClass::Escape:
+							// An unfinished sequence is abandoned if another one begins.
+							state = State::Escape;
+							break;
+						default:
+							break;
+					}
+					break;
+
+				case State::Paste:
+					break;
+			}
+		}
+	}
+
+	void InputDecoder::flush(std::vector<Event> &out) {
+		if (state == State::Paste) {
+			// Hold back anything that could be the start of the terminator.
+			const size_t escape = pasteBuffer.rfind('\e');
+			const size_t keep = escape != std::string::npos && pasteBuffer.size() - escape < 6?
+				pasteBuffer.size() - escape : 0;
+			if (keep < pasteBuffer.size()) {
+				out.emplace_back(Paste {pasteBuffer.substr(0, pasteBuffer.size() - keep)});
+				pasteBuffer.erase(0, pasteBuffer.size() - keep);
+			}
+			return;
+		}
+
+		if (state == State::Escape)
+			out.emplace_back(Key(KeyType::Escape));
+		else if (state == State::CSIStart)
+			out.emplace_back(Key('[', KeyMod::Alt));
+		state = State::Ground;
+	}
+}
@@ -0,0 +1,111 @@
+#include <stdexcept>
+
+#include "haunted/core/InputRecording.h"
+
+namespace Haunted {
+	InputRecorder::InputRecorder(const std::string &path):
+	stream(path, std::ios::binary | std::ios::trunc), start(std::chrono::steady_clock::now()) {
+		if (!stream.is_open())
+			throw std::runtime_error("Couldn't open input recording " + path);
+		stream.write(magic.data(), magic.size());
+	}
+
+
+// Private instance methods
+
+
+	void InputRecorder::writeVarint(uint64_t value) {
+		char bytes[10];
+		size_t length = 0;
+		do {
+			bytes[length++] = char((value & 0x7f) | (0x7f < value? 0x80 : 0));
+			value >>= 7;
+		} while (value != 0);
+		stream.write(bytes, length);
+	}
+
+	void InputRecorder::writeHeader(RecordedInput::Type type) {
+		const auto now = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+		stream.put(char(type));
+		writeVarint(uint64_t((now - last).count()));
+		last = now;
+	}
+
+
+// Public instance methods
+
+
+	void InputRecorder::input(std::string_view bytes) {
+		writeHeader(RecordedInput::Type::Input);
+		writeVarint(bytes.size());
+		stream.write(bytes.data(), bytes.size());
+		// Flushed right away so that a recording of a session that crashes is still useful.
+		stream.flush();
+	}
+
+	void InputRecorder::flush() {
+		writeHeader(RecordedInput::Type::Flush);
+		stream.flush();
+	}
+
+
+	InputPlayback::InputPlayback(const std::string &path): stream(path, std::ios::binary) {
+		if (!stream.is_open())
+			throw std::runtime_error("Couldn't open input recording " + path);
+
+		std::string header(InputRecorder::magic.size(), '\0');
+		if (!stream.read(header.data(), header.size()) || header != InputRecorder::magic)
+			throw std::runtime_error(path + " isn't an input recording");
+	}
+
+
+// Private instance methods
+
+
+	bool InputPlayback::readVarint(uint64_t &out) {
+		out = 0;
+		for (int shift = 0; shift < 64; shift += 7) {
+			const int byte = stream.get();
+			if (byte == std::char_traits<char>::eof())
+				return false;
+			out |= uint64_t(byte & 0x7f) << shift;
+			if (!(byte & 0x80))
+				return true;
+		}
+
+		throw std::runtime_error("Invalid varint in input recording");
+	}
+
+
+// Public instance methods
+
+
+	bool InputPlayback::next(RecordedInput &out) {
+		const int type = stream.get();
+		if (type == std::char_traits<char>::eof())
+			return false;
+
+		if (type != int(RecordedInput::Type::Input) && type != int(RecordedInput::Type::Flush))
+			throw std::runtime_error("Invalid entry type in input recording: " + std::to_string(type));
+
+		uint64_t delta;
+		if (!readVarint(delta))
+			throw std::runtime_error("Input recording is truncated");
+
+		time += std::chrono::microseconds(delta);
+		out.type = RecordedInput::Type(type);
+		out.time = time;
+		out.bytes.clear();
+
+		if (out.type == RecordedInput::Type::Input) {
+			uint64_t length;
+			if (!readVarint(length))
+				throw std::runtime_error("Input recording is truncated");
+			out.bytes.resize(length);
+			if (!stream.read(out.bytes.data(), length))
+				throw std::runtime_error("Input recording is truncated");
+		}
+
+		return true;
+	}
+}
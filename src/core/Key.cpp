@@ -61,9 +61,9 @@ namespace Haunted {
 	}
 
 	Key::operator std::string() const {
-		auto found = keymap.find(type);
-		if (found != keymap.end())
-			return modString(mods) + found->second;
+		const int index = int(type);
+		if (0 <= index && index < int(nameCount) && names[index] != nullptr)
+			return modString(mods) + names[index];
 		return modString(mods) + static_cast<char>(type);
 	}
 
@@ -106,35 +106,37 @@ namespace Haunted {
 		}
 	}
 
-	std::unordered_map<KeyType, std::string> Key::keymap = {
-		{KeyType::CarriageReturn, "↩"},
-		{KeyType::UpArrow,        "↑"},
-		{KeyType::DownArrow,      "↓"},
-		{KeyType::RightArrow,     "→"},
-		{KeyType::LeftArrow,      "←"},
-		{KeyType::Enter,          "⌅"},
-		{KeyType::Tab,            "⇥"},
-		{KeyType::Escape,         "⎋"},
-		{KeyType::Backspace,      "⌫"},
-		{KeyType::Space,          "␣"},
-		{KeyType::Home,           "⭶"},
-		{KeyType::End,            "⭸"},
-		{KeyType::Insert,         "Ins"},
-		{KeyType::PageUp,         "⭻"},
-		{KeyType::PageDown,       "⭽"},
-		{KeyType::F1,             "F1"},
-		{KeyType::F2,             "F2"},
-		{KeyType::F3,             "F3"},
-		{KeyType::F4,             "F4"},
-		{KeyType::F5,             "F5"},
-		{KeyType::F6,             "F6"},
-		{KeyType::F7,             "F7"},
-		{KeyType::F8,             "F8"},
-		{KeyType::F9,             "F9"},
-		{KeyType::F10,            "F10"},
-		{KeyType::F11,            "F11"},
-		{KeyType::F12,            "F12"},
-	};
+	const std::array<const char *, Key::nameCount> Key::names = [] {
+		std::array<const char *, nameCount> names {};
+		names[size_t(KeyType::CarriageReturn)] = "↩";
+		names[size_t(KeyType::UpArrow)]        = "↑";
+		names[size_t(KeyType::DownArrow)]      = "↓";
+		names[size_t(KeyType::RightArrow)]     = "→";
+		names[size_t(KeyType::LeftArrow)]      = "←";
+		names[size_t(KeyType::Enter)]          = "⌅";
+		names[size_t(KeyType::Tab)]            = "⇥";
+		names[size_t(KeyType::Escape)]         = "⎋";
+		names[size_t(KeyType::Backspace)]      = "⌫";
+		names[size_t(KeyType::Space)]          = "␣";
+		names[size_t(KeyType::Home)]           = "⭶";
+		names[size_t(KeyType::End)]            = "⭸";
+		names[size_t(KeyType::Insert)]         = "Ins";
+		names[size_t(KeyType::PageUp)]         = "⭻";
+		names[size_t(KeyType::PageDown)]       = "⭽";
+		names[size_t(KeyType::F1)]             = "F1";
+		names[size_t(KeyType::F2)]             = "F2";
+		names[size_t(KeyType::F3)]             = "F3";
+		names[size_t(KeyType::F4)]             = "F4";
+		names[size_t(KeyType::F5)]             = "F5";
+		names[size_t(KeyType::F6)]             = "F6";
+		names[size_t(KeyType::F7)]             = "F7";
+		names[size_t(KeyType::F8)]             = "F8";
+		names[size_t(KeyType::F9)]             = "F9";
+		names[size_t(KeyType::F10)]            = "F10";
+		names[size_t(KeyType::F11)]            = "F11";
+		names[size_t(KeyType::F12)]            = "F12";
+		return names;
+	}();
 
 	ModSet Key::getModSet(KeyMod mod) {
 		switch (int(mod)) {
@@ -0,0 +1,126 @@
+#include <stdexcept>
+
+#include "haunted/core/Keymap.h"
+
+namespace Haunted {
+
+
+// Private instance methods
+
+
+	uint32_t Keymap::addNode() {
+		if (!freeNodes.empty()) {
+			const uint32_t index = freeNodes.back();
+			freeNodes.pop_back();
+			return index;
+		}
+
+		nodes.emplace_back();
+		return uint32_t(nodes.size() - 1);
+	}
+
+	uint32_t Keymap::find(const std::vector<Key> &keys) const {
+		uint32_t index = 0;
+		for (const Key &key: keys) {
+			const auto &next = nodes[index].next;
+			auto iter = next.find(key.pack());
+			if (iter == next.end())
+				return 0;
+			index = iter->second;
+		}
+
+		return index;
+	}
+
+
+// Public instance methods
+
+
+	void Keymap::bind(const std::vector<Key> &keys, Action action) {
+		if (keys.empty())
+			throw std::invalid_argument("Can't bind an empty key sequence");
+
+		// Check for conflicts before adding any nodes so that a rejected binding leaves the keymap unchanged.
+		uint32_t index = 0;
+		size_t depth = 0;
+		for (; depth < keys.size(); ++depth) {
+			auto iter = nodes[index].next.find(keys[depth].pack());
+			if (iter == nodes[index].next.end())
+				break;
+			index = iter->second;
+			if (depth + 1 < keys.size() && nodes[index].action)
+				throw std::invalid_argument("Key sequence begins with an existing binding");
+		}
+
+		if (depth == keys.size() && !nodes[index].next.empty())
+			throw std::invalid_argument("Key sequence is the beginning of an existing binding");
+
+		for (; depth < keys.size(); ++depth) {
+			// addNode may reallocate the node vector, so the parent is looked up again afterward.
+			const uint32_t child = addNode();
+			nodes[index].next.emplace(keys[depth].pack(), child);
+			index = child;
+		}
+
+		nodes[index].action = std::move(action);
+		position = 0;
+	}
+
+	bool Keymap::unbind(const std::vector<Key> &keys) {
+		// Remember the path so that nodes left with nothing to do can be pruned on the way back up.
+		std::vector<uint32_t> path {0};
+		for (const Key &key: keys) {
+			auto iter = nodes[path.back()].next.find(key.pack());
+			if (iter == nodes[path.back()].next.end())
+				return false;
+			path.push_back(iter->second);
+		}
+
+		if (path.size() == 1 || !nodes[path.back()].action)
+			return false;
+
+		nodes[path.back()].action = nullptr;
+		for (size_t i = path.size() - 1; 0 < i; --i) {
+			Node &node = nodes[path[i]];
+			if (node.action || !node.next.empty())
+				break;
+			nodes[path[i - 1]].next.erase(keys[i - 1].pack());
+			freeNodes.push_back(path[i]);
+		}
+
+		position = 0;
+		return true;
+	}
+
+	Keymap::Match Keymap::feed(const Key &key) {
+		const uint32_t packed = key.pack();
+		auto *next = &nodes[position].next;
+		auto iter = next->find(packed);
+
+		if (iter == next->end() && position != 0) {
+			position = 0;
+			next = &nodes[0].next;
+			iter = next->find(packed);
+		}
+
+		if (iter == next->end())
+			return Match::None;
+
+		const Node &node = nodes[iter->second];
+		if (!node.next.empty() && !node.action) {
+			position = iter->second;
+			return Match::Partial;
+		}
+
+		position = 0;
+		// Copied in case the action changes the bindings.
+		const Action action = node.action;
+		return action && action(key)? Match::Full : Match::None;
+	}
+
+	void Keymap::clear() {
+		nodes.assign(1, Node());
+		freeNodes.clear();
+		position = 0;
+	}
+}
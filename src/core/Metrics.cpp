@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <cmath>
+
+#include "haunted/core/Metrics.h"
+#include "haunted/ui/Control.h"
+
+namespace Haunted {
+	void LockStats::record(std::chrono::nanoseconds wait) {
+		const uint64_t nanos = wait.count();
+		contended.fetch_add(1, std::memory_order_relaxed);
+		waitNanos.fetch_add(nanos, std::memory_order_relaxed);
+		uint64_t max = maxWaitNanos.load(std::memory_order_relaxed);
+		while (max < nanos && !maxWaitNanos.compare_exchange_weak(max, nanos, std::memory_order_relaxed));
+	}
+
+
+// Private static methods
+
+
+	size_t LatencyHistogram::bucketFor(uint64_t nanos) {
+		if (nanos < 8)
+			return nanos;
+		const int msb = 63 - __builtin_clzll(nanos);
+		return std::min<size_t>((msb - 2) * 8 + ((nanos >> (msb - 3)) & 7), bucketCount - 1);
+	}
+
+	uint64_t LatencyHistogram::upperBound(size_t bucket) {
+		if (bucket < 8)
+			return bucket;
+		const int msb = bucket / 8 + 2;
+		return ((8 + bucket % 8 + 1) << (msb - 3)) - 1;
+	}
+
+
+// Public instance methods
+
+
+	void LatencyHistogram::record(std::chrono::nanoseconds duration) {
+		buckets[bucketFor(std::max<int64_t>(0, duration.count()))].fetch_add(1, std::memory_order_relaxed);
+	}
+
+	std::chrono::nanoseconds LatencyHistogram::percentile(double fraction) const {
+		const uint64_t total = count();
+		if (total == 0)
+			return std::chrono::nanoseconds(0);
+
+		const uint64_t target = std::max<uint64_t>(1, std::ceil(fraction * total));
+		uint64_t seen = 0;
+		for (size_t bucket = 0; bucket < bucketCount; ++bucket) {
+			seen += buckets[bucket].load(std::memory_order_relaxed);
+			if (target <= seen)
+				return std::chrono::nanoseconds(upperBound(bucket));
+		}
+
+		return std::chrono::nanoseconds(upperBound(bucketCount - 1));
+	}
+
+	uint64_t LatencyHistogram::count() const {
+		uint64_t out = 0;
+		for (const auto &bucket: buckets)
+			out += bucket.load(std::memory_order_relaxed);
+		return out;
+	}
+
+	void LatencyHistogram::reset() {
+		for (auto &bucket: buckets)
+			bucket.store(0, std::memory_order_relaxed);
+	}
+
+	Metrics::DrawTimer::DrawTimer(Metrics *metrics_, const UI::Control *control_):
+	metrics(metrics_->enabled? metrics_ : nullptr), control(control_) {
+		if (metrics)
+			start = std::chrono::steady_clock::now();
+	}
+
+	Metrics::DrawTimer::~DrawTimer() {
+		if (metrics)
+			metrics->recordDraw(control, std::chrono::steady_clock::now() - start);
+	}
+
+	void Metrics::recordFrame(const FrameStats &stats) {
+		if (!enabled)
+			return;
+		frames.fetch_add(1, std::memory_order_relaxed);
+		bytes.fetch_add(stats.bytes, std::memory_order_relaxed);
+		sequences.fetch_add(stats.sequences, std::memory_order_relaxed);
+		lastBytes.store(stats.bytes, std::memory_order_relaxed);
+		lastSequences.store(stats.sequences, std::memory_order_relaxed);
+		if (0 < stats.latency.count())
+			frameLatency.record(stats.latency);
+	}
+
+	void Metrics::recordDraw(const UI::Control *control, std::chrono::nanoseconds duration) {
+		std::unique_lock<std::mutex> uniq(drawMutex);
+		DrawStats &stats = drawStats[control];
+		if (stats.draws++ == 0)
+			stats.id = control->getID();
+		stats.total += duration;
+		stats.max = std::max(stats.max, duration);
+	}
+
+	void Metrics::forget(const UI::Control *control) {
+		std::unique_lock<std::mutex> uniq(drawMutex);
+		drawStats.erase(control);
+	}
+
+	Metrics::Snapshot Metrics::snapshot() {
+		Snapshot out;
+		out.frames = frames;
+		out.bytes = bytes;
+		out.sequences = sequences;
+		out.lastBytes = lastBytes;
+		out.lastSequences = lastSequences;
+		out.p50 = frameLatency.percentile(0.5);
+		out.p99 = frameLatency.percentile(0.99);
+
+		auto copy = [](const LockStats &stats) {
+			return Snapshot::Lock {stats.acquisitions, stats.contended, std::chrono::nanoseconds(stats.waitNanos),
+				std::chrono::nanoseconds(stats.maxWaitNanos)};
+		};
+
+		out.renderLock = copy(renderLock);
+		out.outputLock = copy(outputLock);
+		out.lineLock = copy(lineLock);
+
+		{
+			std::unique_lock<std::mutex> uniq(drawMutex);
+			out.draws.reserve(drawStats.size());
+			for (const auto &[control, stats]: drawStats)
+				out.draws.push_back(stats);
+		}
+
+		std::sort(out.draws.begin(), out.draws.end(), [](const DrawStats &left, const DrawStats &right) {
+			return left.total > right.total;
+		});
+
+		return out;
+	}
+
+	void Metrics::reset() {
+		frames = bytes = sequences = lastBytes = lastSequences = 0;
+		frameLatency.reset();
+		for (LockStats *stats: {&renderLock, &outputLock, &lineLock})
+			stats->acquisitions = stats->contended = stats->waitNanos = stats->maxWaitNanos = 0;
+		std::unique_lock<std::mutex> uniq(drawMutex);
+		drawStats.clear();
+	}
+}
@@ -1,6 +1,6 @@
+#include <cstdlib>
 #include <stdexcept>
 #include <string>
-#include <vector>
 
 #include "haunted/core/Mouse.h"
 
@@ -12,21 +12,20 @@ namespace Haunted {
 	}
 
 	MouseReport::MouseReport(const std::string &combined): finalChar(combined.back()) {
-		std::vector<std::string> numbers = formicine::util::split(combined.substr(1, combined.length() - 2), ";");
+		// The numbers are scanned in place rather than split into separate strings.
+		long numbers[3];
+		const char *ptr = combined.c_str() + 1;
+		for (int i = 0; i < 3; ++i) {
+			char *end;
+			numbers[i] = std::strtol(ptr, &end, 10);
+			if (end == ptr || *end != (i < 2? ';' : finalChar) || (i == 2 && end != &combined.back()))
+				throw std::invalid_argument("Invalid mouse report");
+			ptr = end + 1;
+		}
 
-		if (numbers.size() != 3)
-			throw std::invalid_argument("Invalid number of parameters in mouse report");
-		
-		long type;
-		if (!formicine::util::parse_long(numbers[0], type))
-			throw std::invalid_argument("Couldn't parse mouse report type as a number");
-		if (!formicine::util::parse_long(numbers[1], x))
-			throw std::invalid_argument("Couldn't parse mouse report x coordinate as a number");
-		if (!formicine::util::parse_long(numbers[2], y))
-			throw std::invalid_argument("Couldn't parse mouse report y coordinate as a number");
-		--x;
-		--y;
-		decodeType(type, combined.back(), action, button, mods);
+		x = numbers[1] - 1;
+		y = numbers[2] - 1;
+		decodeType(numbers[0], finalChar, action, button, mods);
 	}
 
 	std::string MouseReport::str() const {
@@ -43,6 +42,8 @@ namespace Haunted {
 
 		const std::string out = Key::modString(mods) + " " + action_str + " " + std::to_string(x) + " "
 			+ std::to_string(y);
+		if (action == MouseAction::ScrollUp || action == MouseAction::ScrollDown)
+			return out + " x" + std::to_string(count);
 		if (action != MouseAction::Move) // TODO: support middle mouse button
 			return out + (button == MouseButton::Left? " left" : " right");
 		return out;
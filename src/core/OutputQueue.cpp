@@ -0,0 +1,68 @@
+#include <thread>
+
+#include "haunted/core/OutputQueue.h"
+
+namespace Haunted {
+	OutputQueue::OutputQueue(size_t capacity) {
+		size_t size = 2;
+		while (size < capacity)
+			size <<= 1;
+
+		slots = std::make_unique<Slot[]>(size);
+		mask = size - 1;
+		for (size_t i = 0; i < size; ++i)
+			slots[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+
+// Public instance methods
+
+
+	bool OutputQueue::tryPush(Chunk &&chunk) {
+		size_t position = head.load(std::memory_order_relaxed);
+		Slot *slot;
+
+		for (;;) {
+			slot = &slots[position & mask];
+			const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+			const intptr_t difference = intptr_t(sequence) - intptr_t(position);
+			if (difference == 0) {
+				// The slot is free for this position; try to claim it before another producer does.
+				if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+					break;
+			} else if (difference < 0) {
+				// The consumer hasn't gotten to the chunk that was pushed one lap ago.
+				return false;
+			} else {
+				position = head.load(std::memory_order_relaxed);
+			}
+		}
+
+		slot->chunk = std::move(chunk);
+		slot->sequence.store(position + 1, std::memory_order_release);
+		wake();
+		return true;
+	}
+
+	void OutputQueue::push(Chunk &&chunk) {
+		while (!tryPush(std::move(chunk)))
+			std::this_thread::yield();
+	}
+
+	bool OutputQueue::tryPop(Chunk &out) {
+		Slot &slot = slots[tail & mask];
+		if (slot.sequence.load(std::memory_order_acquire) != tail + 1)
+			return false;
+
+		out = std::move(slot.chunk);
+		slot.chunk = {};
+		slot.sequence.store(tail + mask + 1, std::memory_order_release);
+		++tail;
+		return true;
+	}
+
+	void OutputQueue::wake() {
+		signal.fetch_add(1, std::memory_order_release);
+		signal.notify_one();
+	}
+}
@@ -0,0 +1,962 @@
+#include <algorithm>
+#include <cstdlib>
+
+#include "haunted/core/Screen.h"
+
+namespace Haunted {
+	Screen::Screen(int width_, int height_) {
+		resize(width_, height_);
+	}
+
+
+// Private instance methods
+
+
+	void Screen::print(const std::string &glyph, int glyph_width) {
+		if (width <= 0 || height <= 0)
+			return;
+
+		if (glyph_width == 0) {
+			// Combining characters and the like are attached to whatever was printed last.
+			int x = pendingWrap? cursorX : cursorX - 1;
+			if (0 < x && at(x, cursorY).glyph.empty())
+				--x;
+			if (0 <= x)
+				at(x, cursorY).glyph += glyph;
+			return;
+		}
+
+		if (pendingWrap) {
+			carriageReturn();
+			linefeed();
+		}
+
+		if (glyph_width == 2 && cursorX == maxX()) {
+			// A doublewide character can't be split across rows.
+			if (!autowrap)
+				return;
+			at(cursorX, cursorY) = blank();
+			carriageReturn();
+			linefeed();
+		}
+
+		const int max_x = maxX();
+
+		// Overwriting half of a doublewide character erases the other half.
+		Cell &cell = at(cursorX, cursorY);
+		if (cell.glyph.empty() && 0 < cursorX)
+			at(cursorX - 1, cursorY).glyph = " ";
+		const int end = cursorX + glyph_width - 1;
+		if (end < width - 1 && at(end + 1, cursorY).glyph.empty())
+			at(end + 1, cursorY).glyph = " ";
+
+		cell = pen;
+		cell.glyph = glyph;
+		lastGlyph = glyph;
+		lastGlyphWidth = glyph_width;
+		if (glyph_width == 2 && cursorX < width - 1) {
+			Cell &continuation = at(cursorX + 1, cursorY);
+			continuation = pen;
+			continuation.glyph.clear();
+		}
+
+		if (max_x <= end) {
+			cursorX = max_x;
+			pendingWrap = autowrap;
+		} else {
+			cursorX += glyph_width;
+		}
+	}
+
+	void Screen::linefeed() {
+		pendingWrap = false;
+		if (cursorY == bottom) {
+			if (!hmarginsEnabled || (left <= cursorX && cursorX <= right))
+				scroll(1);
+		} else if (cursorY < height - 1) {
+			++cursorY;
+		}
+	}
+
+	void Screen::carriageReturn() {
+		pendingWrap = false;
+		cursorX = hmarginsEnabled && left <= cursorX? left : 0;
+	}
+
+	void Screen::escape(char ch) {
+		switch (ch) {
+			case '7': // DECSC
+				saved.x = cursorX;
+				saved.y = cursorY;
+				saved.pen = pen;
+				saved.originMode = originMode;
+				break;
+			case '8': // DECRC
+				cursorX = std::min(saved.x, width - 1);
+				cursorY = std::min(saved.y, height - 1);
+				pen = saved.pen;
+				originMode = saved.originMode;
+				pendingWrap = false;
+				break;
+			case 'D': // IND
+				linefeed();
+				break;
+			case 'E': // NEL
+				carriageReturn();
+				linefeed();
+				break;
+			case 'M': // RI
+				pendingWrap = false;
+				if (cursorY == top)
+					scroll(-1);
+				else if (0 < cursorY)
+					--cursorY;
+				break;
+			case 'c': // RIS
+				pen = Pen();
+				hmarginsEnabled = originMode = false;
+				autowrap = cursorVisible = true;
+				resize(width, height);
+				clear();
+				break;
+			default:
+				break;
+		}
+	}
+
+	void Screen::dispatchCSI(char final_char) {
+		char prefix = '\0';
+		std::string body = params;
+		if (!body.empty() && '<' <= body.front() && body.front() <= '?') {
+			prefix = body.front();
+			body.erase(0, 1);
+		}
+
+		// Intermediate bytes (0x20 to 0x2f) come after the parameters.
+		std::string intermediates;
+		while (!body.empty() && 0x20 <= body.back() && body.back() <= 0x2f) {
+			intermediates.insert(intermediates.begin(), body.back());
+			body.pop_back();
+		}
+
+		if (prefix == '?') {
+			if (intermediates.empty() && (final_char == 'h' || final_char == 'l'))
+				setMode(parseParams(body, 0), true, final_char == 'h');
+			return;
+		}
+
+		std::vector<int> args = parseParams(body, 0);
+		// Most sequences treat a missing or zero parameter as 1.
+		auto arg = [&](size_t index, int default_value = 1) {
+			return index < args.size() && args[index] != 0? args[index] : default_value;
+		};
+
+		if (prefix == '\0' && intermediates == "$" && final_char == 'z') { // DECERA
+			const int y_offset = originMode? top : 0, x_offset = originMode && hmarginsEnabled? left : 0;
+			erase(arg(1) - 1 + x_offset, arg(0) - 1 + y_offset, arg(3, width) - 1 + x_offset,
+				arg(2, height) - 1 + y_offset);
+			return;
+		}
+
+		if (prefix != '\0' || !intermediates.empty())
+			return;
+
+		const int rel_y = originMode? cursorY - top : cursorY;
+		const int rel_x = originMode && hmarginsEnabled? cursorX - left : cursorX;
+
+		switch (final_char) {
+			case '@': { // ICH
+				const int n = arg(0), max_x = maxX();
+				for (int x = max_x; cursorX <= x; --x)
+					at(x, cursorY) = x - n < cursorX? blank() : at(x - n, cursorY);
+				pendingWrap = false;
+				break;
+			}
+			case 'A': // CUU
+				cursorY = std::max(cursorY - arg(0), top <= cursorY? top : 0);
+				pendingWrap = false;
+				break;
+			case 'B': // CUD
+				cursorY = std::min(cursorY + arg(0), cursorY <= bottom? bottom : height - 1);
+				pendingWrap = false;
+				break;
+			case 'C': // CUF
+				cursorX = std::min(cursorX + arg(0), maxX());
+				pendingWrap = false;
+				break;
+			case 'D': // CUB
+				cursorX = std::max(cursorX - arg(0), minX());
+				pendingWrap = false;
+				break;
+			case 'E': // CNL
+				cursorY = std::min(cursorY + arg(0), cursorY <= bottom? bottom : height - 1);
+				carriageReturn();
+				break;
+			case 'F': // CPL
+				cursorY = std::max(cursorY - arg(0), top <= cursorY? top : 0);
+				carriageReturn();
+				break;
+			case 'G': // CHA
+			case '`': // HPA
+				moveTo(arg(0) - 1, rel_y);
+				break;
+			case 'd': // VPA
+				moveTo(rel_x, arg(0) - 1);
+				break;
+			case 'H': // CUP
+			case 'f': // HVP
+				moveTo(arg(1) - 1, arg(0) - 1);
+				break;
+			case 'J': // ED
+				switch (arg(0, 0)) {
+					case 0:
+						erase(cursorX, cursorY, width - 1, cursorY);
+						erase(0, cursorY + 1, width - 1, height - 1);
+						break;
+					case 1:
+						erase(0, 0, width - 1, cursorY - 1);
+						erase(0, cursorY, cursorX, cursorY);
+						break;
+					default:
+						erase(0, 0, width - 1, height - 1);
+				}
+				pendingWrap = false;
+				break;
+			case 'K': // EL
+				switch (arg(0, 0)) {
+					case 0:  erase(cursorX, cursorY, width - 1, cursorY); break;
+					case 1:  erase(0, cursorY, cursorX, cursorY); break;
+					default: erase(0, cursorY, width - 1, cursorY);
+				}
+				pendingWrap = false;
+				break;
+			case 'L': // IL
+			case 'M': // DL
+				if (top <= cursorY && cursorY <= bottom) {
+					const int old_top = top;
+					top = cursorY;
+					scroll(final_char == 'L'? -arg(0) : arg(0));
+					top = old_top;
+					carriageReturn();
+				}
+				break;
+			case 'P': { // DCH
+				const int n = arg(0), max_x = maxX();
+				for (int x = cursorX; x <= max_x; ++x)
+					at(x, cursorY) = x + n <= max_x? at(x + n, cursorY) : blank();
+				pendingWrap = false;
+				break;
+			}
+			case 'X': // ECH
+				erase(cursorX, cursorY, cursorX + arg(0) - 1, cursorY);
+				pendingWrap = false;
+				break;
+			case 'b': // REP
+				if (!lastGlyph.empty())
+					for (int i = arg(0); 0 < i; --i)
+						print(lastGlyph, lastGlyphWidth);
+				break;
+			case 'S': // SU
+				scroll(arg(0));
+				break;
+			case 'T': // SD
+				scroll(-arg(0));
+				break;
+			case 'm':
+				sgr(args);
+				break;
+			case 'r': { // DECSTBM
+				const int new_top = arg(0) - 1, new_bottom = arg(1, height) - 1;
+				if (new_top < new_bottom && new_bottom < height) {
+					top = new_top;
+					bottom = new_bottom;
+					moveTo(0, 0);
+				}
+				break;
+			}
+			case 's':
+				if (hmarginsEnabled) { // DECSLRM
+					const int new_left = arg(0) - 1, new_right = arg(1, width) - 1;
+					if (new_left < new_right && new_right < width) {
+						left = new_left;
+						right = new_right;
+						moveTo(0, 0);
+					}
+				} else { // SCOSC
+					escape('7');
+				}
+				break;
+			case 'u': // SCORC
+				escape('8');
+				break;
+			case 'h':
+			case 'l':
+				setMode(args, false, final_char == 'h');
+				break;
+			default:
+				break;
+		}
+	}
+
+	void Screen::sgr(const std::vector<int> &args) {
+		if (args.empty()) {
+			pen = Pen();
+			return;
+		}
+
+		// Truecolor is approximated with the 6x6x6 cube of the 256-color palette.
+		auto extended = [&](size_t &i) -> int16_t {
+			if (i + 1 < args.size() && args[i + 1] == 5 && i + 2 < args.size()) {
+				i += 2;
+				return args[i] & 0xff;
+			}
+
+			if (i + 1 < args.size() && args[i + 1] == 2 && i + 4 < args.size()) {
+				auto cube = [](int component) { return std::clamp(component, 0, 255) * 6 / 256; };
+				const int16_t index = 16 + 36 * cube(args[i + 2]) + 6 * cube(args[i + 3]) + cube(args[i + 4]);
+				i += 4;
+				return index;
+			}
+
+			return -1;
+		};
+
+		for (size_t i = 0; i < args.size(); ++i) {
+			const int arg = args[i];
+			switch (arg) {
+				case 0:  pen = Pen(); break;
+				case 1:  pen.attributes |= Cell::Bold;      break;
+				case 2:  pen.attributes |= Cell::Dim;       break;
+				case 3:  pen.attributes |= Cell::Italic;    break;
+				case 4:  pen.attributes |= Cell::Underline; break;
+				case 5:  pen.attributes |= Cell::Blink;     break;
+				case 7:  pen.attributes |= Cell::Inverse;   break;
+				case 9:  pen.attributes |= Cell::Strike;    break;
+				case 22: pen.attributes &= ~(Cell::Bold | Cell::Dim); break;
+				case 23: pen.attributes &= ~Cell::Italic;    break;
+				case 24: pen.attributes &= ~Cell::Underline; break;
+				case 25: pen.attributes &= ~Cell::Blink;     break;
+				case 27: pen.attributes &= ~Cell::Inverse;   break;
+				case 29: pen.attributes &= ~Cell::Strike;    break;
+				case 38: pen.foreground = extended(i); break;
+				case 39: pen.foreground = -1; break;
+				case 48: pen.background = extended(i); break;
+				case 49: pen.background = -1; break;
+				default:
+					if (30 <= arg && arg <= 37)
+						pen.foreground = arg - 30;
+					else if (40 <= arg && arg <= 47)
+						pen.background = arg - 40;
+					else if (90 <= arg && arg <= 97)
+						pen.foreground = arg - 90 + 8;
+					else if (100 <= arg && arg <= 107)
+						pen.background = arg - 100 + 8;
+			}
+		}
+	}
+
+	void Screen::setMode(const std::vector<int> &args, bool is_private, bool enable) {
+		if (!is_private)
+			return;
+
+		for (const int mode: args) {
+			switch (mode) {
+				case 6: // DECOM
+					originMode = enable;
+					moveTo(0, 0);
+					break;
+				case 7: // DECAWM
+					autowrap = enable;
+					pendingWrap = false;
+					break;
+				case 25: // DECTCEM
+					cursorVisible = enable;
+					break;
+				case 69: // DECLRMM
+					hmarginsEnabled = enable;
+					if (!enable) {
+						left = 0;
+						right = width - 1;
+					}
+					break;
+				default:
+					break;
+			}
+		}
+	}
+
+	void Screen::scroll(int rows) {
+		if (rows == 0 || width <= 0 || height <= 0)
+			return;
+
+		const int x1 = hmarginsEnabled? left : 0, x2 = hmarginsEnabled? right : width - 1;
+		const int region = bottom - top + 1;
+		rows = std::clamp(rows, -region, region);
+
+		if (0 < rows) {
+			for (int y = top; y <= bottom; ++y)
+				for (int x = x1; x <= x2; ++x)
+					at(x, y) = y + rows <= bottom? at(x, y + rows) : blank();
+		} else {
+			for (int y = bottom; top <= y; --y)
+				for (int x = x1; x <= x2; ++x)
+					at(x, y) = top <= y + rows? at(x, y + rows) : blank();
+		}
+
+		pendingWrap = false;
+	}
+
+	void Screen::erase(int x1, int y1, int x2, int y2) {
+		x1 = std::max(x1, 0);
+		y1 = std::max(y1, 0);
+		x2 = std::min(x2, width - 1);
+		y2 = std::min(y2, height - 1);
+
+		const Cell empty = blank();
+		for (int y = y1; y <= y2; ++y)
+			for (int x = x1; x <= x2; ++x)
+				at(x, y) = empty;
+	}
+
+	void Screen::moveTo(int x, int y) {
+		int min_x = 0, max_x = width - 1, min_y = 0, max_y = height - 1;
+
+		if (originMode) {
+			min_y = top;
+			max_y = bottom;
+			if (hmarginsEnabled) {
+				min_x = left;
+				max_x = right;
+			}
+		}
+
+		cursorX = std::clamp(x + min_x, min_x, std::max(min_x, max_x));
+		cursorY = std::clamp(y + min_y, min_y, std::max(min_y, max_y));
+		pendingWrap = false;
+	}
+
+	Cell Screen::blank() const {
+		Cell out;
+		out.background = pen.background;
+		return out;
+	}
+
+	std::optional<std::string> Screen::overwrite(const Pen &current, int from_x, int to_x, int y) const {
+		std::string out;
+		for (int x = from_x; x < to_x; ++x) {
+			const Cell &cell = at(x, y);
+			// Cells with a different style or part of a doublewide character can't simply be reprinted.
+			if (!cell.sameStyle(current) || cell.glyph.empty() || (x + 1 < width && at(x + 1, y).glyph.empty()))
+				return std::nullopt;
+			out += cell.glyph;
+		}
+
+		return out;
+	}
+
+	uint64_t Screen::rowHash(int y) const {
+		// FNV-1a over the glyphs and styles of the row's cells.
+		uint64_t hash = 14695981039346656037ull;
+		auto mix = [&hash](uint8_t byte) { hash = (hash ^ byte) * 1099511628211ull; };
+		for (int x = 0; x < width; ++x) {
+			const Cell &cell = at(x, y);
+			for (const char ch: cell.glyph)
+				mix(ch);
+			mix(0);
+			mix(cell.foreground & 0xff);
+			mix(cell.foreground >> 8);
+			mix(cell.background & 0xff);
+			mix(cell.background >> 8);
+			mix(cell.attributes);
+		}
+
+		return hash;
+	}
+
+	bool Screen::sameRow(const Screen &other, int y, int other_y) const {
+		for (int x = 0; x < width; ++x)
+			if (at(x, y) != other.at(x, other_y))
+				return false;
+		return true;
+	}
+
+	int Screen::rowCost(int y) const {
+		const Cell empty;
+		int last = width - 1;
+		while (0 <= last && at(last, y) == empty)
+			--last;
+
+		int cost = 0;
+		for (int x = 0; x <= last; ++x)
+			cost += at(x, y).glyph.size();
+		return cost;
+	}
+
+	std::string Screen::scrollFront(Screen &front, const Pen &current) const {
+		if (height < 2)
+			return {};
+
+		std::vector<uint64_t> back_hashes(height), front_hashes(height);
+		std::vector<int> costs(height);
+		std::vector<bool> intact(height);
+		for (int y = 0; y < height; ++y) {
+			back_hashes[y] = rowHash(y);
+			front_hashes[y] = front.rowHash(y);
+			costs[y] = rowCost(y);
+			intact[y] = back_hashes[y] == front_hashes[y] && sameRow(front, y, y);
+		}
+
+		if (std::find(intact.begin(), intact.end(), false) == intact.end())
+			return {};
+
+		// The search trusts the hashes; the chosen block is compared cell by cell afterwards.
+		auto matches = [&](int y, int front_y) { return back_hashes[y] == front_hashes[front_y]; };
+
+		auto sequence = [](int top, int bottom, int shift) {
+			std::string out = "\e[" + std::to_string(top + 1) + ";" + std::to_string(bottom + 1) + "r\e[";
+			if (shift != 1 && shift != -1)
+				out += std::to_string(std::abs(shift));
+			return out + (0 < shift? "S" : "T") + "\e[r";
+		};
+
+		// Look for the block of rows that moved by the same amount and whose reuse saves the most output. A positive
+		// shift means the content moved up.
+		int best_gain = 0, best_top = 0, best_bottom = 0, best_shift = 0, best_first = 0, best_end = 0;
+		for (int shift = 1 - height; shift < height; ++shift) {
+			if (shift == 0)
+				continue;
+
+			const int limit = std::min(height, height - shift);
+			for (int y = std::max(0, -shift); y < limit;) {
+				if (!matches(y, y + shift)) {
+					++y;
+					continue;
+				}
+
+				int gain = 0, end = y;
+				for (; end < limit && matches(end, end + shift); ++end)
+					if (!intact[end])
+						gain += costs[end];
+
+				// Scrolling blanks the rows exposed on the other side of the block, which may have been correct already.
+				const int exposed_top = 0 < shift? end : y + shift, exposed_bottom = 0 < shift? end + shift - 1 : y - 1;
+				for (int exposed = exposed_top; exposed <= exposed_bottom; ++exposed)
+					if (intact[exposed])
+						gain -= costs[exposed];
+
+				const int top = std::min(y, y + shift), bottom = std::max(end - 1, end - 1 + shift);
+				gain -= sequence(top, bottom, shift).size();
+				if (best_gain < gain) {
+					best_gain = gain;
+					best_top = top;
+					best_bottom = bottom;
+					best_shift = shift;
+					best_first = y;
+					best_end = end;
+				}
+
+				y = end;
+			}
+		}
+
+		if (best_shift == 0)
+			return {};
+
+		for (int y = best_first; y < best_end; ++y)
+			if (!sameRow(front, y, y + best_shift))
+				return {};
+
+		const std::string out = sequence(best_top, best_bottom, best_shift);
+		front.pen = current;
+		front.feed(out);
+		return out;
+	}
+
+	std::vector<int> Screen::parseParams(const std::string &str, int default_value) {
+		std::vector<int> out;
+		if (str.empty())
+			return out;
+
+		int current = -1;
+		for (const char ch: str) {
+			if ('0' <= ch && ch <= '9') {
+				current = (current == -1? 0 : current * 10) + (ch - '0');
+			} else if (ch == ';' || ch == ':') {
+				out.push_back(current == -1? default_value : current);
+				current = -1;
+			}
+		}
+
+		out.push_back(current == -1? default_value : current);
+		return out;
+	}
+
+
+// Public instance methods
+
+
+	void Screen::resize(int width_, int height_) {
+		width_  = std::max(width_,  0);
+		height_ = std::max(height_, 0);
+
+		std::vector<Cell> new_cells(width_ * height_);
+		for (int y = 0, max_y = std::min(height, height_); y < max_y; ++y)
+			for (int x = 0, max_x = std::min(width, width_); x < max_x; ++x)
+				new_cells[y * width_ + x] = at(x, y);
+
+		cells = std::move(new_cells);
+		width = width_;
+		height = height_;
+		top = left = 0;
+		bottom = height - 1;
+		right = width - 1;
+		cursorX = std::clamp(cursorX, 0, std::max(width - 1, 0));
+		cursorY = std::clamp(cursorY, 0, std::max(height - 1, 0));
+		pendingWrap = false;
+	}
+
+	void Screen::clear() {
+		std::fill(cells.begin(), cells.end(), blank());
+		cursorX = cursorY = 0;
+		pendingWrap = false;
+	}
+
+	void Screen::feed(std::string_view input) {
+		for (const char ch: input) {
+			const unsigned char byte = ch;
+
+			switch (state) {
+				case State::Ground:
+					if (!utf8.empty()) {
+						if ((byte & 0xc0) == 0x80) {
+							utf8.push_back(ch);
+							if (utf8.size() < utf8Expected)
+								continue;
+
+							uint32_t codepoint = static_cast<unsigned char>(utf8[0]) & (0x7f >> utf8Expected);
+							for (size_t i = 1; i < utf8.size(); ++i)
+								codepoint = (codepoint << 6) | (static_cast<unsigned char>(utf8[i]) & 0x3f);
+							print(utf8, glyphWidth(codepoint));
+							utf8.clear();
+							continue;
+						}
+
+						// The sequence was cut short by something that isn't a continuation byte.
+						utf8.clear();
+					}
+
+					if (byte == 0x1b) {
+						state = State::Escape;
+						params.clear();
+					} else if (byte == '\n') {
+						// The output post-processing that terminals do by default (ONLCR) turns a newline into a
+						// carriage return and a line feed.
+						carriageReturn();
+						linefeed();
+					} else if (byte == '\r') {
+						carriageReturn();
+					} else if (byte == '\b') {
+						if (minX() < cursorX)
+							--cursorX;
+						pendingWrap = false;
+					} else if (byte == '\t') {
+						cursorX = std::min((cursorX / 8 + 1) * 8, maxX());
+					} else if (byte == 0x0b || byte == 0x0c) {
+						linefeed();
+					} else if (0x20 <= byte && byte < 0x7f) {
+						print(std::string(1, ch), 1);
+					} else if (0xc0 <= byte && byte < 0xf8) {
+						utf8.push_back(ch);
+						utf8Expected = byte < 0xe0? 2 : byte < 0xf0? 3 : 4;
+					}
+					break;
+
+				case State::Escape:
+					if (byte == '[') {
+						state = State::CSI;
+					} else if (byte == ']' || byte == 'P' || byte == '_' || byte == '^' || byte == 'X') {
+						state = State::String;
+					} else if (0x20 <= byte && byte <= 0x2f) {
+						// Intermediate bytes, as in charset designations. The sequence is ignored.
+						params.push_back(ch);
+					} else {
+						if (params.empty())
+							escape(ch);
+						state = State::Ground;
+					}
+					break;
+
+				case State::CSI:
+					if (0x40 <= byte && byte <= 0x7e) {
+						dispatchCSI(ch);
+						state = State::Ground;
+					} else if (byte == 0x1b) {
+						state = State::Escape;
+						params.clear();
+					} else if (0x20 <= byte) {
+						params.push_back(ch);
+					}
+					break;
+
+				case State::String:
+					if (byte == 0x1b)
+						state = State::StringEscape;
+					else if (byte == 0x07)
+						state = State::Ground;
+					break;
+
+				case State::StringEscape:
+					state = byte == '\\'? State::Ground : State::String;
+					break;
+			}
+		}
+	}
+
+	std::string Screen::rowText(int y) const {
+		std::string out;
+		for (int x = 0; x < width; ++x)
+			out += at(x, y).glyph;
+		return out;
+	}
+
+	std::string Screen::diff(Screen &front) const {
+		std::string out;
+
+		if (front.width != width || front.height != height) {
+			// If the dimensions don't match, the contents of the display are unknown, so we start from a blank slate.
+			front.resize(width, height);
+			front.pen = Pen();
+			front.clear();
+			out += "\e[0m\e[?6l\e[?69l\e[r\e[H\e[2J";
+		}
+
+		Pen emitted = front.pen;
+		// The cursor position becomes unknown after writing to the last column because of the pending wrap.
+		int cx = front.cursorX, cy = front.cursorY;
+
+		auto jump = [&](int x, int y) {
+			if (cx == x && cy == y)
+				return;
+			out += front.planMove(emitted, cx, cy, x, y);
+			cx = x;
+			cy = y;
+		};
+
+		// Content that moved vertically is cheaper to scroll into place than to repaint.
+		if (const std::string scrolled = scrollFront(front, emitted); !scrolled.empty()) {
+			out += scrolled;
+			cx = front.cursorX;
+			cy = front.cursorY;
+		}
+
+		for (int y = 0; y < height; ++y) {
+			int x = 0;
+			while (x < width) {
+				if (at(x, y) == front.at(x, y)) {
+					++x;
+					continue;
+				}
+
+				// A changed continuation cell requires its doublewide character to be reprinted.
+				int start = x;
+				if (at(x, y).glyph.empty() && 0 < x)
+					start = x - 1;
+
+				// Extend the run through any short stretches of unchanged cells; rewriting a few cells that already
+				// have the right contents is cheaper than the cursor movement needed to skip over them.
+				int end = x;
+				for (int scan = x + 1, unchanged = 0; scan < width; ++scan) {
+					if (at(scan, y) != front.at(scan, y)) {
+						end = scan;
+						unchanged = 0;
+					} else if (4 < ++unchanged || !at(scan, y).sameStyle(emitted)) {
+						break;
+					}
+				}
+
+				if (end + 1 < width && at(end + 1, y).glyph.empty())
+					++end;
+
+				jump(start, y);
+				for (int i = start; i <= end; ++i) {
+					const Cell &cell = at(i, y);
+					front.at(i, y) = cell;
+					if (cell.glyph.empty())
+						continue;
+					out += transition(emitted, cell);
+					emitted = cell;
+					emitted.glyph.clear();
+					out += cell.glyph;
+				}
+
+				cx = end + 1;
+				if (width <= cx)
+					cx = cy = -1;
+
+				x = end + 1;
+			}
+		}
+
+		if (front.cursorVisible != cursorVisible)
+			out += cursorVisible? "\e[?25h" : "\e[?25l";
+
+		if (0 < width && 0 < height)
+			jump(cursorX, cursorY);
+
+		front.pen = emitted;
+		front.cursorX = cursorX;
+		front.cursorY = cursorY;
+		front.cursorVisible = cursorVisible;
+		return out;
+	}
+
+
+	std::string Screen::planMove(const Pen &current, int from_x, int from_y, int to_x, int to_y) const {
+		std::string absolute = "\e[";
+		if (to_y != 0 || to_x != 0)
+			absolute += std::to_string(to_y + 1);
+		if (to_x != 0)
+			absolute += ";" + std::to_string(to_x + 1);
+		absolute += "H";
+
+		if (from_x < 0 || from_y < 0 || width <= from_x || height <= from_y)
+			return absolute;
+
+		auto repeat = [](const char *str, int count) {
+			std::string out;
+			for (int i = 0; i < count; ++i)
+				out += str;
+			return out;
+		};
+
+		auto csi = [](int count, char final_char) {
+			return "\e[" + (count == 1? std::string() : std::to_string(count)) + final_char;
+		};
+
+		// Each vertical candidate is paired with the column the cursor ends up in.
+		std::vector<std::pair<std::string, int>> vertical;
+		const int dy = to_y - from_y;
+		if (dy == 0) {
+			vertical.emplace_back("", from_x);
+		} else {
+			vertical.emplace_back("\e[" + std::to_string(to_y + 1) + "d", from_x); // VPA
+			if (0 < dy) {
+				vertical.emplace_back(csi(dy, 'B'), from_x); // CUD
+				// Output post-processing turns a line feed into a carriage return and a line feed.
+				vertical.emplace_back(repeat("\n", dy), 0);
+			} else {
+				vertical.emplace_back(csi(-dy, 'A'), from_x); // CUU
+				vertical.emplace_back(repeat("\eM", -dy), from_x); // RI; never at the top row here, so it can't scroll
+			}
+		}
+
+		auto horizontal = [&](int start_x) {
+			const int dx = to_x - start_x;
+			if (dx == 0)
+				return std::string();
+
+			std::string best = "\e[" + std::to_string(to_x + 1) + "G"; // CHA, the widely supported form of HPA
+			auto consider = [&](std::string &&candidate) {
+				if (candidate.size() < best.size())
+					best = std::move(candidate);
+			};
+
+			if (0 < dx) {
+				consider(csi(dx, 'C')); // CUF
+				// Reprinting more cells than this can't beat the other options.
+				if (dx < 8)
+					if (auto reprinted = overwrite(current, start_x, to_x, to_y))
+						consider(std::move(*reprinted));
+			} else {
+				consider(csi(-dx, 'D')); // CUB
+				if (-dx < int(best.size()))
+					consider(repeat("\b", -dx));
+			}
+
+			if (to_x == 0) {
+				consider("\r");
+			} else if (to_x < start_x && to_x < 8) {
+				if (auto reprinted = overwrite(current, 0, to_x, to_y))
+					consider("\r" + *reprinted);
+			}
+
+			return best;
+		};
+
+		std::string best = absolute;
+		for (const auto &[motion, column]: vertical) {
+			std::string candidate = motion + horizontal(column);
+			if (candidate.size() < best.size())
+				best = std::move(candidate);
+		}
+
+		return best;
+	}
+
+
+// Public static methods
+
+
+	std::string Screen::transition(const Pen &from, const Pen &to) {
+		if (from.sameStyle(to))
+			return "";
+
+		std::string codes;
+		auto add = [&](const std::string &code) {
+			if (!codes.empty())
+				codes.push_back(';');
+			codes += code;
+		};
+
+		auto color = [](int16_t index, bool background) -> std::string {
+			if (index < 0)
+				return background? "49" : "39";
+			if (index < 8)
+				return std::to_string((background? 40 : 30) + index);
+			if (index < 16)
+				return std::to_string((background? 100 : 90) + index - 8);
+			return (background? "48;5;" : "38;5;") + std::to_string(index);
+		};
+
+		Pen base = from;
+		if ((from.attributes & ~to.attributes) != 0) {
+			// Turning individual attributes off isn't supported everywhere, so we start over instead.
+			add("0");
+			base = Pen();
+		}
+
+		static constexpr std::pair<uint8_t, const char *> attribute_codes[] = {
+			{Cell::Bold, "1"}, {Cell::Dim, "2"}, {Cell::Italic, "3"}, {Cell::Underline, "4"}, {Cell::Blink, "5"},
+			{Cell::Inverse, "7"}, {Cell::Strike, "9"}
+		};
+
+		for (const auto &[attribute, code]: attribute_codes)
+			if ((to.attributes & attribute) && !(base.attributes & attribute))
+				add(code);
+
+		if (base.foreground != to.foreground)
+			add(color(to.foreground, false));
+
+		if (base.background != to.background)
+			add(color(to.background, true));
+
+		return codes.empty()? "" : "\e[" + codes + "m";
+	}
+
+	int Screen::glyphWidth(uint32_t codepoint) {
+		// Combining marks, zero-width joiners and variation selectors don't occupy any columns of their own.
+		if ((0x0300 <= codepoint && codepoint <= 0x036f) || (0x200b <= codepoint && codepoint <= 0x200f) ||
+		    (0xfe00 <= codepoint && codepoint <= 0xfe0f) || (0x1f3fb <= codepoint && codepoint <= 0x1f3ff) ||
+		    (0xe0020 <= codepoint && codepoint <= 0xe007f))
+			return 0;
+
+		if ((0x1100  <= codepoint && codepoint <= 0x115f)  || (0x2e80  <= codepoint && codepoint <= 0xa4cf)  ||
+		    (0xac00  <= codepoint && codepoint <= 0xd7a3)  || (0xf900  <= codepoint && codepoint <= 0xfaff)  ||
+		    (0xfe30  <= codepoint && codepoint <= 0xfe4f)  || (0xff00  <= codepoint && codepoint <= 0xff60)  ||
+		    (0xffe0  <= codepoint && codepoint <= 0xffe6)  || (0x1f300 <= codepoint && codepoint <= 0x1f64f) ||
+		    (0x1f900 <= codepoint && codepoint <= 0x1f9ff) || (0x20000 <= codepoint && codepoint <= 0x3fffd))
+			return 2;
+
+		return 1;
+	}
+}
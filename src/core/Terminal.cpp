@@ -1,13 +1,19 @@
+#include <algorithm>
 #include <deque>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
 #include <string>
 
 #include <csignal>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/ioctl.h>
 #include <unistd.h>
 
-#include "haunted/core/CSI.h"
 #include "haunted/core/Key.h"
 #include "haunted/core/Terminal.h"
 #include "haunted/core/Util.h"
@@ -17,12 +23,16 @@
 #include "lib/formicine/futil.h"
 
 namespace Haunted {
-	using uchar = unsigned char;
-
+	std::atomic<int> Terminal::winchFd {-1};
 	std::vector<Terminal *> Terminal::winchTargets {};
+	std::mutex Terminal::winchTargetsMutex;
+	std::atomic<uint64_t> Terminal::nextId {1};
 
 	Terminal::Terminal(std::istream &inStream, ansi::ansistream &outStream):
-	inStream(inStream), outStream(outStream), colors(&outStream, &outputMutex) {
+	inStream(inStream), outStream(outStream), colors(this) {
+		if (&inStream != &std::cin)
+			inFd = -1;
+		bindDefaultKeys();
 		original = attrs = getattr();
 		winsize size;
 		ioctl(STDIN_FILENO, TIOCGWINSZ, &size);
@@ -30,8 +40,29 @@ namespace Haunted {
 		cols = size.ws_col;
 	}
 
+	Terminal::Terminal(std::istream &inStream, ansi::ansistream &outStream, int rows_, int cols_):
+	rows(rows_), cols(cols_), attached(false), inStream(inStream), outStream(outStream), colors(this) {
+		inFd = -1;
+		original = attrs = termios();
+		bindDefaultKeys();
+	}
+
 	Terminal::~Terminal() {
-		if (!suppressOutput) {
+		{
+			std::unique_lock<std::mutex> winch_lock(winchTargetsMutex);
+			winchTargets.erase(std::remove(winchTargets.begin(), winchTargets.end(), this), winchTargets.end());
+		}
+
+		{
+			// The screen is about to be cleared, so there's no point in drawing anything still waiting to be drawn.
+			std::unique_lock<std::mutex> dirty_lock(dirtyMutex);
+			dirtyControls.clear();
+		}
+
+		stopRendering();
+		stopOutput();
+		buffered = false;
+		if (!suppressOutput && attached) {
 			outStream.reset_colors();
 			outStream.clear();
 			reset();
@@ -47,8 +78,20 @@ namespace Haunted {
 
 
 	void Terminal::winchHandler(int) {
+		const int saved_errno = errno;
+		const uint64_t one = 1;
+		[[maybe_unused]] ssize_t result = ::write(winchFd, &one, sizeof(one));
+		errno = saved_errno;
+	}
+
+	void Terminal::handleWinch() {
+		uint64_t count;
+		if (::read(winchFd, &count, sizeof(count)) != sizeof(count))
+			return;
+
 		winsize new_size;
 		ioctl(STDIN_FILENO, TIOCGWINSZ, &new_size);
+		std::unique_lock<std::mutex> lock(winchTargetsMutex);
 		for (Terminal *terminal: winchTargets)
 			terminal->winch(new_size.ws_row, new_size.ws_col);
 	}
@@ -73,35 +116,497 @@ namespace Haunted {
 
 
 	void Terminal::apply() {
-		setattr(attrs);
+		if (attached)
+			setattr(attrs);
 	}
 
 	void Terminal::reset() {
+		if (!attached)
+			return;
 		mouse(MouseMode::None);
+		bracketedPaste(false);
 		setattr(original);
 		attrs = original;
 	}
 
+	std::string Terminal::MarginState::resetSequence() const {
+		std::string out;
+		if (origin)
+			out += "\e[?6l";
+		if (top != -1 || bottom != -1)
+			out += "\e[r";
+		if (hmarginsEnabled)
+			out += "\e[?69l";
+		return out;
+	}
+
+	Terminal::Fragment & Terminal::getFragment() {
+		// Finding the fragment in the map requires the fragment mutex, so each thread remembers the last one it used.
+		thread_local uint64_t cached_id = 0;
+		thread_local Fragment *cached = nullptr;
+		if (cached_id == id)
+			return *cached;
+
+		std::unique_lock<std::mutex> lock(fragmentMutex);
+		std::unique_ptr<Fragment> &fragment = fragments[std::this_thread::get_id()];
+		if (!fragment)
+			fragment = std::make_unique<Fragment>();
+		cached_id = id;
+		cached = fragment.get();
+		return *cached;
+	}
+
+	Terminal::Target Terminal::target(bool reset_margins) {
+		Fragment &fragment = getFragment();
+		const bool direct = fragment.depth == 0 && !buffered && !queueing;
+		Target out = direct? Target {outStream, directMargins, lockOutput()} :
+			Target {fragment.stream, fragment.margins, {}};
+
+		if (reset_margins && out.margins.resetPending) {
+			out.stream << out.margins.resetSequence();
+			out.margins = {};
+		}
+
+		return out;
+	}
+
+	void Terminal::commitFragment(Fragment &fragment) {
+		// The next fragment, from whichever thread, expects the margins to be at their defaults.
+		if (!fragment.margins.isDefault())
+			fragment.stream << fragment.margins.resetSequence();
+		fragment.margins = {};
+
+		std::string data = fragment.capture.str();
+		fragment.capture.str("");
+		const auto started = fragment.started;
+		fragment.started = {};
+
+		if (data.empty() && !buffered)
+			return;
+
+		if (queueing) {
+			outputQueue.push({std::move(data), false, started});
+			return;
+		}
+
+		auto uniq = lockOutput();
+		if (!directMargins.isDefault()) {
+			data = directMargins.resetSequence() + data;
+			directMargins = {};
+		}
+
+		if (buffered) {
+			backBuffer.feed(data);
+			data = backBuffer.diff(frontBuffer);
+		}
+
+		if (writeFrame(std::move(data), started) && framePostlistener) {
+			const FrameStats stats = lastFrame;
+			uniq.unlock();
+			framePostlistener(stats);
+		}
+	}
+
 	void Terminal::workInput() {
-		Key key;
 		// Sometimes, calling cbreak() once doesn't seem to properly set all the flags (e.g., arrow keys produce strings
 		// like "^[[C"). Calling it twice appears to work, but it's not pretty.
 		cbreak();
 		cbreak();
+		std::vector<InputDecoder::Event> events;
+		pollfd fds[] {{inFd, POLLIN, 0}, {inputWakeFd, POLLIN, 0}, {-1, POLLIN, 0}};
+
+		while (reading) {
+			// Wait for stopInput and window resizes as well as for input. Input that can only be read from a stream
+			// can't be waited on this way, so stopping has to wait for the next key press in that case. The resize
+			// descriptor is negative (and ignored by poll) until watchSize is first called, which can happen at any
+			// time.
+			fds[2].fd = winchFd;
+			if (0 <= inFd && poll(fds, 3, -1) < 0 && errno != EINTR)
+				break;
+			if (!reading || (fds[1].revents & POLLIN))
+				break;
+			if (fds[2].revents & POLLIN)
+				handleWinch();
+			if (0 <= inFd && !(fds[0].revents & (POLLIN | POLLHUP | POLLERR)))
+				continue;
+
+			events.clear();
+			if (!readInput(events))
+				break;
+			if (coalesce)
+				coalesceMouse(events);
+			for (InputDecoder::Event &event: events)
+				if (!inputQueue.push(std::move(event), reading))
+					break;
+		}
+
+		inputEnded = true;
+		inputQueue.wake();
+	}
+
+	void Terminal::workDispatch() {
 		while (alive) {
-			*this >> key;
-			if (key == Key(KeyType::c, KeyMod::Ctrl) && (!onInterrupt || onInterrupt()))
+			const uint32_t epoch = inputQueue.epoch();
+			if (!dispatchInput())
 				break;
-			sendKey(key);
+			if (inputQueue.depth() == 0)
+				inputQueue.wait(epoch);
 		}
 	}
 
+	bool Terminal::readInput(std::vector<InputDecoder::Event> &out, bool wait) {
+		char buffer[16384];
+		ssize_t count;
+
+		if (0 <= inFd) {
+			do
+				count = ::read(inFd, buffer, sizeof(buffer));
+			while (count < 0 && errno == EINTR);
+		} else if (inStream.get(buffer[0])) {
+			count = 1 + std::max<std::streamsize>(0, inStream.readsome(buffer + 1, sizeof(buffer) - 1));
+		} else {
+			count = 0;
+		}
+
+		if (count <= 0) {
+			// Whatever was left over when the input ended won't be completed.
+			if (!decoder.partial())
+				return false;
+			flushDecoder(out);
+			return true;
+		}
+
+		if (recorder)
+			recorder->input({buffer, size_t(count)});
+
+		decoder.raw = raw;
+		decoder.feed({buffer, size_t(count)}, out);
+
+		// A lone escape can't be told apart from the start of a sequence until more input arrives or it doesn't.
+		if (wait && decoder.partial() && 0 <= inFd && !pollInput(escapeTimeout))
+			flushDecoder(out);
+
+		return true;
+	}
+
+	bool Terminal::pollInput(std::chrono::milliseconds timeout) {
+		pollfd fd {inFd, POLLIN, 0};
+		int result;
+		do
+			result = poll(&fd, 1, int(timeout.count()));
+		while (result < 0 && errno == EINTR);
+		return 0 < result;
+	}
+
+	void Terminal::flushDecoder(std::vector<InputDecoder::Event> &out) {
+		if (recorder)
+			recorder->flush();
+		decoder.flush(out);
+	}
+
+	bool Terminal::handleInput(std::vector<InputDecoder::Event> &events) {
+		if (coalesce)
+			coalesceMouse(events);
+
+		for (InputDecoder::Event &event: events)
+			if (!handleEvent(event))
+				return false;
+
+		return true;
+	}
+
+	bool Terminal::handleEvent(InputDecoder::Event &event) {
+		if (MouseReport *report = std::get_if<MouseReport>(&event)) {
+			dispatchMouse(*report);
+			sendKey(KeyType::Mouse);
+			return true;
+		}
+
+		if (const InputDecoder::Paste *paste = std::get_if<InputDecoder::Paste>(&event)) {
+			sendPaste(paste->text);
+			return true;
+		}
+
+		const Key &key = std::get<Key>(event);
+		if (key == Key(KeyType::c, KeyMod::Ctrl) && (!onInterrupt || onInterrupt()))
+			return false;
+		sendKey(key);
+		return true;
+	}
+
+	void Terminal::coalesceMouse(std::vector<InputDecoder::Event> &events) {
+		auto scroll_delta = [](const MouseReport &report) -> long {
+			if (report.action == MouseAction::ScrollUp)
+				return -report.count;
+			return report.action == MouseAction::ScrollDown? report.count : 0;
+		};
+
+		size_t kept = 0;
+		for (size_t i = 0; i < events.size(); ++i) {
+			const MouseReport *report = std::get_if<MouseReport>(&events[i]);
+			MouseReport *previous = kept == 0? nullptr : std::get_if<MouseReport>(&events[kept - 1]);
+
+			if (report && previous && report->mods == previous->mods) {
+				// Only the latest position matters for motion. Dragging is decided later by dispatchMouse, which
+				// sees the presses and releases in between because those are never merged.
+				if (report->action == MouseAction::Move && previous->action == MouseAction::Move) {
+					*previous = *report;
+					continue;
+				}
+
+				const long delta = scroll_delta(*report), previous_delta = scroll_delta(*previous);
+				if (delta != 0 && previous_delta != 0 && report->x == previous->x && report->y == previous->y) {
+					const long sum = previous_delta + delta;
+					if (sum == 0) {
+						// Scrolling back and forth cancels out entirely.
+						--kept;
+					} else {
+						previous->action = sum < 0? MouseAction::ScrollUp : MouseAction::ScrollDown;
+						previous->count = std::abs(sum);
+					}
+					continue;
+				}
+			}
+
+			if (kept != i)
+				events[kept] = std::move(events[i]);
+			++kept;
+		}
+
+		events.erase(events.begin() + kept, events.end());
+	}
+
+	template <typename F>
+	UI::InputHandler * Terminal::bubble(UI::Control *control, F handle) {
+		const std::vector<UI::InputHandler *> &path = control->bubblePath();
+		for (UI::InputHandler *handler: path)
+			if (handle(handler))
+				return handler;
+
+		// The root's parent is normally the terminal, but if it isn't, the terminal still gets the last chance.
+		if (path.back() != static_cast<UI::InputHandler *>(this) && handle(this))
+			return this;
+
+		return nullptr;
+	}
+
+	void Terminal::bindDefaultKeys() {
+		keymap = std::make_shared<Keymap>();
+		keymap->bind(Key(KeyType::l, KeyMod::Ctrl), [this](const Key &) {
+			redraw();
+			return true;
+		});
+		keymap->bind(Key(KeyType::y, KeyMod::Ctrl), [this](const Key &) {
+			debugTree();
+			debugMetrics();
+			return true;
+		});
+	}
+
+	std::vector<InputDecoder::Event> Terminal::pasteKeys(const std::string &text) {
+		InputDecoder paste_decoder;
+		std::vector<InputDecoder::Event> out;
+		paste_decoder.feed(text, out);
+		paste_decoder.flush(out);
+		return out;
+	}
+
+	void Terminal::dispatchMouse(MouseReport report) {
+		if (report.action == MouseAction::Down) {
+			dragging = true;
+			dragButton = report.button;
+		} else if (report.action == MouseAction::Up) {
+			dragging = false;
+		}
+
+		if (dragging && report.action == MouseAction::Move) {
+			report.action = MouseAction::Drag;
+			report.button = dragButton;
+		}
+
+		sendMouse(report);
+	}
+
+	void Terminal::workRender() {
+		auto last_frame = std::chrono::steady_clock::now() - frameInterval;
+		std::unique_lock<std::mutex> dirty_lock(dirtyMutex);
+
+		while (rendering) {
+			renderCondition.wait(dirty_lock, [this] { return !rendering || !dirtyControls.empty(); });
+			// Changes made before the next frame is due are coalesced into it.
+			renderCondition.wait_until(dirty_lock, last_frame + frameInterval, [this] { return !rendering; });
+			dirty_lock.unlock();
+
+			{
+				// The render lock has to be acquired before the dirty set is taken so that a control can't be
+				// destroyed between being taken from the set and being drawn.
+				auto lock = lockRender();
+				std::unordered_set<UI::Control *> to_draw;
+				{
+					std::unique_lock<std::mutex> swap_lock(dirtyMutex);
+					to_draw.swap(dirtyControls);
+				}
+
+				drawControls(to_draw);
+			}
+
+			last_frame = std::chrono::steady_clock::now();
+			dirty_lock.lock();
+		}
+	}
+
+	void Terminal::workOutput() {
+		OutputQueue::Chunk chunk;
+		for (;;) {
+			const uint32_t epoch = outputQueue.epoch();
+			if (outputQueue.tryPop(chunk)) {
+				writeQueued(chunk);
+				continue;
+			}
+
+			if (!queueing)
+				break;
+
+			outputQueue.wait(epoch);
+		}
+	}
+
+	void Terminal::writeQueued(OutputQueue::Chunk &chunk) {
+		const auto started = chunk.started;
+		std::string out;
+		bool drawn = false, fed = false;
+
+		// Threads that keep drawing could otherwise keep a batch going indefinitely without anything being written.
+		size_t remaining = maxBatch;
+		auto uniq = lockOutput();
+		do {
+			if (chunk.direct) {
+				// Mode changes have to reach the terminal after whatever was drawn before them.
+				if (fed)
+					out += backBuffer.diff(frontBuffer);
+				fed = false;
+				out += chunk.data;
+				continue;
+			}
+
+			drawn = true;
+			if (buffered) {
+				backBuffer.feed(chunk.data);
+				fed = true;
+			} else {
+				out += chunk.data;
+			}
+		} while (0 < --remaining && outputQueue.tryPop(chunk));
+
+		if (fed)
+			out += backBuffer.diff(frontBuffer);
+
+		bool written = false;
+		try {
+			if (drawn)
+				written = writeFrame(std::move(out), started);
+			else
+				writeOutput(std::move(out));
+		} catch (const std::runtime_error &) {
+			// There's nobody to report the error to, and the terminal is most likely gone anyway.
+		}
+
+		if (written && framePostlistener) {
+			const FrameStats stats = lastFrame;
+			uniq.unlock();
+			framePostlistener(stats);
+		}
+	}
+
+	void Terminal::drawControls(const std::unordered_set<UI::Control *> &to_draw) {
+		if (to_draw.empty())
+			return;
+
+		Frame frame(this);
+		for (UI::Control *control: to_draw) {
+			// Drawing a container also draws its children, so there's no need to draw a control if one of its
+			// ancestors is also dirty.
+			bool covered = false;
+			for (UI::Container *ptr = control->getParent(); ptr && ptr != this;) {
+				UI::Control *ancestor = ptr->toControl();
+				if (ancestor == nullptr)
+					break;
+				if (to_draw.count(ancestor) != 0) {
+					covered = true;
+					break;
+				}
+				ptr = ancestor->getParent();
+			}
+
+			if (!covered)
+				control->draw();
+		}
+
+		jumpToFocused();
+	}
+
+	bool Terminal::writeFrame(std::string data, std::chrono::steady_clock::time_point started) {
+		if (suppressOutput || data.empty())
+			return false;
+
+		if (synchronizedUpdates)
+			data = "\e[?2026h" + data + "\e[?2026l";
+
+		lastFrame = {};
+		lastFrame.bytes = data.size();
+		lastFrame.sequences = std::count(data.begin(), data.end(), '\e');
+
+		// Anything that was written to the output stream directly has to reach the terminal first.
+		outStream.flush();
+		lastFrame.writes = writeOutput(std::move(data));
+
+		if (started != std::chrono::steady_clock::time_point())
+			lastFrame.latency = std::chrono::steady_clock::now() - started;
+		metrics.recordFrame(lastFrame);
+		return true;
+	}
+
+	size_t Terminal::writeAll(const std::string &data) {
+		size_t written = 0, writes = 0;
+		while (written < data.size()) {
+			const ssize_t result = ::write(outFd, data.data() + written, data.size() - written);
+			++writes;
+			if (result < 0) {
+				if (errno == EINTR || errno == EAGAIN)
+					continue;
+				throw std::runtime_error("write returned " + std::to_string(result));
+			}
+
+			written += result;
+		}
+
+		return writes;
+	}
+
+	void Terminal::writeDirect(const std::string &data) {
+		if (queueing)
+			outputQueue.push({data, true});
+		else
+			outStream << data;
+	}
+
+	size_t Terminal::writeOutput(std::string data) {
+		return writeAll(data);
+	}
+
 	void Terminal::winch(int new_rows, int new_cols) {
 		bool changed = rows != new_rows || cols != new_cols;
 		rows = new_rows;
 		cols = new_cols;
 		if (changed) {
 			std::unique_lock<std::mutex> lock(winchMutex);
+			if (buffered) {
+				auto output_lock = lockOutput();
+				// The terminal's contents after a resize can't be predicted, so the front buffer is invalidated by
+				// leaving its size different from the back buffer's.
+				backBuffer.resize(cols, rows);
+				frontBuffer.resize(0, 0);
+			}
 			redraw();
 		}
 	}
@@ -117,15 +622,37 @@ namespace Haunted {
 	}
 
 	void Terminal::watchSize() {
-		if (winchTargets.empty())
-			std::signal(SIGWINCH, &Terminal::winchHandler);
-		winchTargets.push_back(this);
+		std::unique_lock<std::mutex> lock(winchTargetsMutex);
+		if (winchFd < 0) {
+			const int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+			if (fd < 0)
+				throw std::runtime_error("eventfd failed: " + std::string(std::strerror(errno)));
+			winchFd = fd;
+
+			struct sigaction action {};
+			action.sa_handler = &Terminal::winchHandler;
+			sigemptyset(&action.sa_mask);
+			action.sa_flags = SA_RESTART;
+			if (sigaction(SIGWINCH, &action, nullptr) < 0)
+				throw std::runtime_error("sigaction failed: " + std::string(std::strerror(errno)));
+		}
+
+		if (std::find(winchTargets.begin(), winchTargets.end(), this) == winchTargets.end())
+			winchTargets.push_back(this);
 	}
 
 	void Terminal::redraw() {
 		if (root) {
+			Frame frame(this);
 			colors.reset();
-			outStream.clear().jump();
+			{
+				Target out = target(false);
+				// The margin state may not have survived whatever made the redraw necessary, so it's reset
+				// unconditionally.
+				out.stream.reset_origin().vmargins().disable_hmargins();
+				out.margins = {};
+				out.stream.clear().jump();
+			}
 			root->resize({0, 0, cols, rows});
 			root->draw();
 		}
@@ -141,8 +668,10 @@ namespace Haunted {
 	}
 
 	void Terminal::draw() {
-		if (root)
+		if (root) {
+			Frame frame(this);
 			root->draw();
+		}
 	}
 
 	void Terminal::resetColors() {
@@ -150,49 +679,42 @@ namespace Haunted {
 	}
 
 	UI::InputHandler * Terminal::sendKey(const Key &key) {
+		UI::InputHandler *handler = nullptr;
+
 		// If the root is null, there are no controls.
-		if (root == nullptr) {
-			if (keyPostlistener)
-				keyPostlistener(key);
-			return nullptr;
+		if (root != nullptr) {
+			UI::Control *control = getFocused();
+			if (!control)
+				throw std::runtime_error("Focused control is null");
+			handler = bubble(control, [&](UI::InputHandler *ancestor) { return ancestor->handleKey(key); });
 		}
 
-		UI::Control *control = getFocused();
+		if (keyPostlistener)
+			keyPostlistener(key);
 
-		if (!control)
-			throw std::runtime_error("Focused control is null");
+		return handler;
+	}
 
-		if (control->onKey(key)) {
-			if (keyPostlistener)
-				keyPostlistener(key);
-			return control;
-		}
+	UI::InputHandler * Terminal::sendPaste(const std::string &text) {
+		if (root != nullptr) {
+			UI::Control *control = getFocused();
+			if (!control)
+				throw std::runtime_error("Focused control is null");
 
-		UI::Container *ptr = control->getParent();
-		
-		// Keep trying on_key, going up to the root as long as we keep getting false. If we're at the root and on_key
-		// still returns false, let the terminal itself handle the keypress as a last resort.
-		while (ptr && !ptr->onKey(key)) {
-			if (dynamic_cast<UI::Control *>(ptr) == root) {
-				onKey(key);
-				if (keyPostlistener)
-					keyPostlistener(key);
-				return this;
-			}
+			UI::InputHandler *handler = bubble(control, [&](UI::InputHandler *ancestor) {
+				return ancestor->onPaste(text);
+			});
 
-			if (UI::Child *cptr = dynamic_cast<UI::Child *>(ptr)) {
-				ptr = cptr->getParent();
-			} else {
-				if (keyPostlistener)
-					keyPostlistener(key);
-				return nullptr;
-			}
+			if (handler)
+				return handler;
 		}
 
-		if (keyPostlistener)
-			keyPostlistener(key);
+		// Nothing wants the paste as a whole, so send it the way it would have arrived without bracketed paste mode.
+		for (const InputDecoder::Event &event: pasteKeys(text))
+			if (const Key *key = std::get_if<Key>(&event))
+				sendKey(*key);
 
-		return ptr;
+		return nullptr;
 	}
 
 	UI::InputHandler * Terminal::sendMouse(const MouseReport &report) {
@@ -203,67 +725,309 @@ namespace Haunted {
 			return nullptr;
 		}
 
-		if (control->onMouse(report)) {
-			if (mousePostlistener)
-				mousePostlistener(report);
-			return control;
-		}
+		UI::InputHandler *handler = bubble(control, [&](UI::InputHandler *ancestor) {
+			return ancestor->onMouse(report);
+		});
+
+		if (mousePostlistener)
+			mousePostlistener(report);
+
+		return handler;
+	}
+
+	bool Terminal::onKey(const Key &key) {
+		return keymap && keymap->feed(key) != Keymap::Match::None;
+	}
 
-		UI::Container *ptr = control->getParent();
+	bool Terminal::handleKey(const Key &key) {
+		return onKey(key);
+	}
+
+	void Terminal::startInput(bool dispatch) {
+		if (reading)
+			return;
+
+		inputWakeFd = eventfd(0, EFD_CLOEXEC);
+		if (inputWakeFd < 0)
+			throw std::runtime_error("eventfd failed: " + std::string(std::strerror(errno)));
+
+		reading = true;
+		inputEnded = false;
+		inputThread = std::thread(&Terminal::workInput, this);
+		if (dispatch)
+			dispatchThread = std::thread(&Terminal::workDispatch, this);
+	}
+
+	void Terminal::stopInput() {
+		if (!reading.exchange(false) && inputWakeFd < 0)
+			return;
 
-		while (ptr && !ptr->onMouse(report)) {
-			if (dynamic_cast<UI::Control *>(ptr) == root) {
-				onMouse(report);
-				if (mousePostlistener)
-					mousePostlistener(report);
-				return this;
+		const uint64_t one = 1;
+		[[maybe_unused]] ssize_t result = ::write(inputWakeFd, &one, sizeof(one));
+		inputQueue.wakeProducer();
+		join();
+	}
+
+	bool Terminal::dispatchInput() {
+		InputDecoder::Event event;
+		while (inputQueue.tryPop(event)) {
+			if (!handleEvent(event)) {
+				// Stop reading now that nothing will dispatch what's read.
+				reading = false;
+				const uint64_t one = 1;
+				[[maybe_unused]] ssize_t result = ::write(inputWakeFd, &one, sizeof(one));
+				inputQueue.wakeProducer();
+				return false;
 			}
+		}
 
-			if (UI::Child *cptr = dynamic_cast<UI::Child *>(ptr)) {
-				ptr = cptr->getParent();
+		return !inputEnded || inputQueue.depth() != 0;
+	}
+
+	void Terminal::startRecording(const std::string &path) {
+		recorder = std::make_unique<InputRecorder>(path);
+	}
+
+	void Terminal::stopRecording() {
+		recorder.reset();
+	}
+
+	bool Terminal::replay(const std::string &path, bool realtime) {
+		InputPlayback playback(path);
+		RecordedInput entry;
+		std::vector<InputDecoder::Event> events;
+		const auto start = std::chrono::steady_clock::now();
+
+		while (playback.next(entry)) {
+			if (realtime)
+				std::this_thread::sleep_until(start + entry.time);
+
+			events.clear();
+			if (entry.type == RecordedInput::Type::Flush) {
+				decoder.flush(events);
 			} else {
-				if (mousePostlistener)
-					mousePostlistener(report);
-				return nullptr;
+				decoder.raw = raw;
+				decoder.feed(entry.bytes, events);
 			}
+
+			if (!handleInput(events))
+				return false;
 		}
 
-		if (mousePostlistener)
-			mousePostlistener(report);
+		// A recording cut off in the middle of a sequence ends the same way input does.
+		events.clear();
+		decoder.flush(events);
+		return handleInput(events);
+	}
 
-		return ptr;
+	EventLoop & Terminal::getLoop() {
+		if (!loop)
+			loop = std::make_unique<EventLoop>();
+		return *loop;
 	}
 
-	bool Terminal::onKey(const Key &key) {
-		if (key == KeyMod::Ctrl) {
-			switch (key.type) {
-				case KeyType::l:
-					redraw();
-					break;
-				case KeyType::y:
-					debugTree();
-					break;
-				default:
-					return false;
+	void Terminal::run() {
+		if (inFd < 0)
+			throw std::runtime_error("The event loop requires input from a file descriptor");
+
+		EventLoop &event_loop = getLoop();
+		cbreak();
+		cbreak();
+
+		std::vector<InputDecoder::Event> events;
+		int escape_timer = -1;
+		event_loop.watch(inFd, EPOLLIN, [&](uint32_t) {
+			if (escape_timer != -1) {
+				event_loop.cancelTimer(escape_timer);
+				escape_timer = -1;
 			}
 
-			return true;
+			events.clear();
+			if (!readInput(events, false) || !handleInput(events)) {
+				event_loop.stop();
+				return;
+			}
+
+			// Instead of blocking the loop while waiting for the rest of a sequence, resolve it later unless more
+			// input arrives first.
+			if (decoder.partial())
+				escape_timer = event_loop.addTimer(escapeTimeout, std::chrono::nanoseconds(0), [&] {
+					escape_timer = -1;
+					events.clear();
+					flushDecoder(events);
+					if (!handleInput(events))
+						event_loop.stop();
+				});
+		});
+
+		event_loop.watchSignal(SIGWINCH, [this] {
+			winsize size;
+			ioctl(STDIN_FILENO, TIOCGWINSZ, &size);
+			winch(size.ws_row, size.ws_col);
+		});
+
+		event_loop.run();
+		if (escape_timer != -1)
+			event_loop.cancelTimer(escape_timer);
+		event_loop.unwatchSignal(SIGWINCH);
+		event_loop.unwatch(inFd);
+	}
+
+	void Terminal::startOutput() {
+		auto uniq = lockOutput();
+		if (queueing)
+			return;
+		outStream.flush();
+		queueing = true;
+		outputThread = std::thread(&Terminal::workOutput, this);
+	}
+
+	void Terminal::stopOutput() {
+		if (!queueing)
+			return;
+
+		Fragment &fragment = getFragment();
+		if (fragment.depth == 0)
+			commitFragment(fragment);
+
+		{
+			auto uniq = lockOutput();
+			queueing = false;
 		}
 
-		return false;
+		outputQueue.wake();
+		if (outputThread.joinable())
+			outputThread.join();
+
+		// Other threads may have pushed fragments after the output thread last checked the queue.
+		OutputQueue::Chunk chunk;
+		if (outputQueue.tryPop(chunk))
+			writeQueued(chunk);
 	}
 
-	void Terminal::startInput() {
-		inputThread = std::thread(&Terminal::workInput, this);
+	void Terminal::startRendering() {
+		std::unique_lock<std::mutex> dirty_lock(dirtyMutex);
+		if (rendering)
+			return;
+		rendering = true;
+		renderThread = std::thread(&Terminal::workRender, this);
+	}
+
+	void Terminal::stopRendering() {
+		{
+			std::unique_lock<std::mutex> dirty_lock(dirtyMutex);
+			if (!rendering)
+				return;
+			rendering = false;
+		}
+
+		renderCondition.notify_all();
+		if (renderThread.joinable())
+			renderThread.join();
+
+		// Anything that was marked dirty after the last frame still needs to be drawn.
+		auto lock = lockRender();
+		std::unordered_set<UI::Control *> to_draw;
+		{
+			std::unique_lock<std::mutex> dirty_lock(dirtyMutex);
+			to_draw.swap(dirtyControls);
+		}
+
+		drawControls(to_draw);
+	}
+
+	void Terminal::setFrameRate(double fps) {
+		std::unique_lock<std::mutex> dirty_lock(dirtyMutex);
+		frameInterval = fps <= 0? std::chrono::nanoseconds(0) : std::chrono::nanoseconds(int64_t(1e9 / fps));
+	}
+
+	bool Terminal::requestDraw(UI::Control *control) {
+		if (control == nullptr)
+			return false;
+
+		{
+			std::unique_lock<std::mutex> dirty_lock(dirtyMutex);
+			if (!rendering)
+				return false;
+			dirtyControls.insert(control);
+		}
+
+		renderCondition.notify_one();
+		return true;
+	}
+
+	void Terminal::cancelDraw(UI::Control *control) {
+		auto lock = lockRender();
+		std::unique_lock<std::mutex> dirty_lock(dirtyMutex);
+		dirtyControls.erase(control);
 	}
 
 	void Terminal::join() {
+		if (dispatchThread.joinable())
+			dispatchThread.join();
 		if (inputThread.joinable())
 			inputThread.join();
+		if (0 <= inputWakeFd) {
+			::close(inputWakeFd);
+			inputWakeFd = -1;
+		}
 	}
 
 	void Terminal::flush() {
-		outStream.flush();
+		Fragment &fragment = getFragment();
+		// Flushing in the middle of a frame would defeat the purpose of the frame, so it's left to commitFrame.
+		if (0 < fragment.depth)
+			return;
+
+		commitFragment(fragment);
+		if (!buffered && !queueing) {
+			auto uniq = lockOutput();
+			outStream.flush();
+		}
+	}
+
+	void Terminal::beginFrame() {
+		Fragment &fragment = getFragment();
+		if (fragment.depth++ == 0 && metrics.enabled)
+			fragment.started = std::chrono::steady_clock::now();
+	}
+
+	void Terminal::commitFrame() {
+		Fragment &fragment = getFragment();
+		if (fragment.depth == 0)
+			throw std::runtime_error("No frame to commit");
+
+		if (--fragment.depth == 0)
+			commitFragment(fragment);
+	}
+
+	FrameStats Terminal::getLastFrame() const {
+		std::unique_lock<std::mutex> uniq(outputMutex);
+		return lastFrame;
+	}
+
+	void Terminal::setBuffered(bool new_buffered) {
+		Fragment &fragment = getFragment();
+		// Anything the calling thread has written outside a frame is committed the way it was meant to be drawn.
+		if (fragment.depth == 0 && buffered != new_buffered)
+			commitFragment(fragment);
+
+		auto uniq = lockOutput();
+		if (buffered == new_buffered)
+			return;
+
+		if (new_buffered) {
+			// Margins set while drawing unbuffered are still set on the terminal. Resetting them from now on would
+			// only reach the back buffer, so the reset is written directly.
+			if (!directMargins.isDefault())
+				writeDirect(directMargins.resetSequence());
+			directMargins = {};
+			backBuffer = Screen(cols, rows);
+			// Nothing is known about what's on the screen yet, so the first flush has to clear it and draw everything.
+			frontBuffer.resize(0, 0);
+		}
+
+		buffered = new_buffered;
 	}
 
 	void Terminal::focus(UI::Control *to_focus) {
@@ -290,12 +1054,12 @@ namespace Haunted {
 	}
 
 	UI::Control * Terminal::childAtOffset(int x, int y) const {
-		UI::Container *container = dynamic_cast<UI::Container *>(root);
+		UI::Container *container = root? root->toContainer() : nullptr;
 		while (container != nullptr) {
 			UI::Control *control = container->childAtOffset(x, y);
 			if (control == nullptr)
 				return nullptr;
-			container = dynamic_cast<UI::Container *>(control);
+			container = control->toContainer();
 			if (container == nullptr)
 				return control;
 		}
@@ -309,15 +1073,120 @@ namespace Haunted {
 	}
 
 	void Terminal::jump(int x, int y) {
-		std::unique_lock<std::mutex> uniq(outputMutex);
-		outStream.jump(x, y);
+		target().stream.jump(x, y);
+	}
+
+	void Terminal::up(size_t n) {
+		target().stream.up(n);
+	}
+
+	void Terminal::down(size_t n) {
+		target().stream.down(n);
+	}
+
+	void Terminal::right(size_t n) {
+		target().stream.right(n);
+	}
+
+	void Terminal::left(size_t n) {
+		target().stream.left(n);
+	}
+
+	void Terminal::clearLine() {
+		target().stream.clear_line();
+	}
+
+	void Terminal::clearRight() {
+		target().stream.clear_right();
+	}
+
+	void Terminal::clearLeft() {
+		target().stream.clear_left();
+	}
+
+	void Terminal::clearRect(int x, int y, int width, int height) {
+		if (width <= 0 || height <= 0)
+			return;
+
+		Target out = target();
+
+		// EL ignores the left and right margins, so it can only be used if the rectangle touches an edge of the screen.
+		const MarginState &margins = out.margins;
+		const bool h_origin = margins.origin && margins.hmarginsEnabled && margins.left != -1;
+		const int abs_left = x + (h_origin? margins.left : 0);
+		const bool at_left = abs_left == 0, at_right = cols <= abs_left + width;
+
+		auto cup = [](int column, int row) {
+			return "\e[" + std::to_string(row + 1) + ";" + std::to_string(column + 1) + "H";
+		};
+
+		std::string row_clear;
+		int row_x = x;
+		if (at_left && at_right) {
+			row_clear = "\e[2K";
+		} else if (at_right) {
+			row_clear = "\e[K";
+		} else if (at_left) {
+			row_clear = "\e[1K";
+			row_x = x + width - 1;
+		} else {
+			row_clear = std::string(width, ' ');
+			if (capabilities.ech) {
+				std::string ech = width == 1? "\e[X" : "\e[" + std::to_string(width) + "X";
+				if (ech.size() < row_clear.size())
+					row_clear = std::move(ech);
+			}
+
+			if (capabilities.rep && 1 < width) {
+				std::string rep = " \e[" + std::to_string(width - 1) + "b";
+				if (rep.size() < row_clear.size())
+					row_clear = std::move(rep);
+			}
+		}
+
+		std::string sequences;
+		for (int row = y; row < y + height; ++row)
+			sequences += cup(row_x, row) + row_clear;
+
+		if (capabilities.decera && 1 < height) {
+			std::string decera = "\e[" + std::to_string(y + 1) + ";" + std::to_string(x + 1) + ";" +
+				std::to_string(y + height) + ";" + std::to_string(x + width) + "$z";
+			if (decera.size() < sequences.size())
+				sequences = std::move(decera);
+		}
+
+		out.stream << sequences;
+	}
+
+	void Terminal::front() {
+		target().stream.hpos(0);
+	}
+
+	void Terminal::back() {
+		target().stream.hpos(cols);
+	}
+
+	void Terminal::save() {
+		target().stream.save();
+	}
+
+	void Terminal::restore() {
+		target().stream.restore();
+	}
+
+	void Terminal::show() {
+		target().stream.show();
+	}
+
+	void Terminal::hide() {
+		target().stream.hide();
 	}
 
 	void Terminal::mouse(MouseMode mode) {
-		std::unique_lock<std::mutex> uniq(outputMutex);
+		auto uniq = lockOutput();
 		if (mode == MouseMode::None) {
 			if (mmode != mode) {
-				outStream << "\e[?" << std::to_string(int(mmode)) << ";1006l";
+				writeDirect("\e[?" + std::to_string(int(mmode)) + ";1006l");
 				mmode = mode;
 			}
 
@@ -326,39 +1195,81 @@ namespace Haunted {
 
 		if (mode != mmode) {
 			if (mmode != MouseMode::None)
-				outStream << "\e[?" << std::to_string(int(mmode)) << "l";
-			outStream << "\e[?" << std::to_string(int(mode)) << ";1006h";
+				writeDirect("\e[?" + std::to_string(int(mmode)) + "l");
+			writeDirect("\e[?" + std::to_string(int(mode)) + ";1006h");
 			mmode = mode;
 		}
 	}
 
+	void Terminal::bracketedPaste(bool enable) {
+		auto uniq = lockOutput();
+		if (enable != pasteMode) {
+			writeDirect(enable? "\e[?2004h" : "\e[?2004l");
+			pasteMode = enable;
+		}
+	}
+
 	void Terminal::vscroll(int rows) {
-		std::unique_lock<std::mutex> uniq(outputMutex);
+		Target out = target();
 		if (0 < rows) {
-			outStream.scroll_down(rows);
+			out.stream.scroll_down(rows);
 		} else if (rows < 0) {
-			outStream.scroll_up(-rows);
+			out.stream.scroll_up(-rows);
 		}
 	}
 
+	void Terminal::claimMargins(size_t top, size_t bottom, size_t left, size_t right) {
+		target(false).margins.resetPending = false;
+
+		enableHmargins();
+		margins(top, bottom, left, right);
+		setOrigin();
+	}
+
+	void Terminal::releaseMargins() {
+		target(false).margins.resetPending = true;
+	}
+
 	void Terminal::hmargins(size_t left, size_t right) {
-		std::unique_lock<std::mutex> uniq(outputMutex);
-		outStream.hmargins(left, right);
+		Target out = target();
+		MarginState &state = out.margins;
+		// Without DECLRMM, this sequence saves the cursor instead, so there's no margin state to compare against.
+		if (state.hmarginsEnabled) {
+			if (state.left == ssize_t(left) && state.right == ssize_t(right))
+				return;
+			state.left = left;
+			state.right = right;
+		}
+
+		out.stream.hmargins(left, right);
 	}
 
 	void Terminal::hmargins() {
-		std::unique_lock<std::mutex> uniq(outputMutex);
-		outStream.hmargins();
+		Target out = target();
+		MarginState &state = out.margins;
+		if (state.left == -1 && state.right == -1)
+			return;
+		state.left = state.right = -1;
+		out.stream.hmargins();
 	}
 
 	void Terminal::vmargins(size_t top, size_t bottom) {
-		std::unique_lock<std::mutex> uniq(outputMutex);
-		outStream.vmargins(top, bottom);
+		Target out = target();
+		MarginState &state = out.margins;
+		if (state.top == ssize_t(top) && state.bottom == ssize_t(bottom))
+			return;
+		state.top = top;
+		state.bottom = bottom;
+		out.stream.vmargins(top, bottom);
 	}
 
 	void Terminal::vmargins() {
-		std::unique_lock<std::mutex> uniq(outputMutex);
-		outStream.vmargins();
+		Target out = target();
+		MarginState &state = out.margins;
+		if (state.top == -1 && state.bottom == -1)
+			return;
+		state.top = state.bottom = -1;
+		out.stream.vmargins();
 	}
 
 	void Terminal::margins(size_t top, size_t bottom, size_t left, size_t right) {
@@ -372,27 +1283,45 @@ namespace Haunted {
 	}
 
 	void Terminal::enableHmargins() { // DECLRMM: Left Right Margin Mode
-		std::unique_lock<std::mutex> uniq(outputMutex);
-		outStream.enable_hmargins();
+		Target out = target();
+		MarginState &state = out.margins;
+		if (state.hmarginsEnabled)
+			return;
+		state.hmarginsEnabled = true;
+		out.stream.enable_hmargins();
 	}
 
 	void Terminal::disableHmargins() {
-		std::unique_lock<std::mutex> uniq(outputMutex);
-		outStream.disable_hmargins();
+		Target out = target();
+		MarginState &state = out.margins;
+		if (!state.hmarginsEnabled)
+			return;
+		// Disabling DECLRMM also resets the horizontal margins.
+		state.hmarginsEnabled = false;
+		state.left = state.right = -1;
+		out.stream.disable_hmargins();
 	}
 
 	void Terminal::setOrigin() {
-		std::unique_lock<std::mutex> uniq(outputMutex);
-		outStream.set_origin();
+		Target out = target();
+		MarginState &state = out.margins;
+		if (state.origin)
+			return;
+		state.origin = true;
+		out.stream.set_origin();
 	}
 
 	void Terminal::resetOrigin() {
-		std::unique_lock<std::mutex> uniq(outputMutex);
-		outStream.reset_origin();
+		Target out = target();
+		MarginState &state = out.margins;
+		if (!state.origin)
+			return;
+		state.origin = false;
+		out.stream.reset_origin();
 	}
 
 	std::unique_lock<std::recursive_mutex> Terminal::lockRender() {
-		return std::unique_lock<std::recursive_mutex>(renderMutex);
+		return metrics.lock(renderMutex, metrics.renderLock);
 	}
 
 
@@ -417,129 +1346,32 @@ namespace Haunted {
 	}
 
 	Terminal & Terminal::operator>>(Key &key) {
-		// If we receive an escape followed by a [ and another escape, we return Alt+[ after receiving the second
-		// escape, but this discards the second escape. To make up for this, we use a static bool to indicate that this
-		// weird sequence has occurred.
-		static bool partial_escape = false;
-
-		char c;
-		if (raw) {
-			*this >> c;
-			key = c;
-			return *this;
-		}
-
 		key = 0;
 
-		if (!(*this >> c))
-			return *this;
-
-		// It's important to reset the partial_escape flag. Resetting it right after reading it prevents me from having
-		// to insert a reset before every return statement.
-		bool escape = partial_escape || c == uchar(KeyType::Escape);
-		partial_escape = false;
-
-		if (escape) {
-			// If we read an escape byte, that means something interesting is about to happen.
-
-			if (!(*this >> c))
-				return *this;
-
-			if (c == uchar(KeyType::Escape)) {
-				// We can't tell the difference between an actual press of the escape key and the beginning of a CSI.
-				// Perhaps it would be possible with the use of some timing trickery, but I don't consider that
-				// necessary right now (YAGNI!). Instead, the user will have to press the escape key twice.
-				key = {c, KeyMod::None};
-				partial_escape = true; // ???
+		while (pendingIndex == pendingInput.size()) {
+			pendingInput.clear();
+			pendingIndex = 0;
+			if (!readInput(pendingInput))
 				return *this;
-			} else if (c == uchar(KeyType::OpenSquare)) {
-				if (!(*this >> c))
-					return *this;
-
-				switch (c) {
-					// To input an actual Alt+[, the user has to press the [ key again. Otherwise, we wouldn't be able
-					// to tell the difference between an actual Alt+[ and the beginning of a CSI.
-					case '[':
-						key = {c, KeyMod::Alt};
-						return *this;
-
-					// If there's another escape immediately after "^[", we'll assume the user typed an actual Alt+[ and
-					// then input another escape sequence.
-					case int(KeyType::Escape):
-						partial_escape = false;
-						key = {'[', KeyMod::Alt};
-						return *this;
-
-					// If the first character after the [ is A, B, C or D, it's an arrow key.
-					case 'A': key = KeyType::UpArrow;    return *this;
-					case 'B': key = KeyType::DownArrow;  return *this;
-					case 'C': key = KeyType::RightArrow; return *this;
-					case 'D': key = KeyType::LeftArrow;  return *this;
-				}
-
-				// At this point, we haven't yet determined what the input is. A CSI sequence ends with a character in
-				// the range [0x40, 0x7e]. Let's read until we encounter one.
-				static std::string buffer;
-				buffer = c;
-
-				while (!Util::isFinalchar(c)) {
-					if (!(*this >> c))
-						return *this;
-
-					buffer += c;
-				}
-
-				const char back = buffer.back();
-				if (back == 'M' || back == 'm') {
-					if (buffer.front() != '<') {
-						DBG("Unrecognized sequence: \"" << buffer << "\"");
-						throw std::invalid_argument("Unrecognized sequence");
-					}
-
-					MouseReport report(buffer);
-
-					if (report.action == MouseAction::Down) {
-						dragging = true;
-						dragButton = report.button;
-					} else if (report.action == MouseAction::Up) {
-						dragging = false;
-					}
-
-					if (dragging && report.action == MouseAction::Move) {
-						report.action = MouseAction::Drag;
-						report.button = dragButton;
-					}
-
-					sendMouse(report);
-
-					key = KeyType::Mouse;
-					return *this;
-				}
-
-				const CSI parsed = buffer;
-
-				// Sometimes, getKey() returns keys with modifiers already set. For example, ^[Z represents shift+tab.
-				// If these modifiers are already set, then modifiers weren't specified the CSI u way and we shouldn't
-				// change them.
-				key = parsed.getKey();
-				if (key.mods.none())
-					key = Key(key.type, ModSet((parsed.second - 1) & 7));
+			if (coalesce)
+				coalesceMouse(pendingInput);
+		}
 
-				return *this;
-			}
+		InputDecoder::Event &event = pendingInput[pendingIndex];
+		if (InputDecoder::Paste *paste = std::get_if<InputDecoder::Paste>(&event)) {
+			// Keys are read one at a time, so a paste read this way is split back into the keys it's made of.
+			std::vector<InputDecoder::Event> keys = pasteKeys(paste->text);
+			pendingInput.erase(pendingInput.begin() + pendingIndex);
+			pendingInput.insert(pendingInput.begin() + pendingIndex, keys.begin(), keys.end());
+			return *this >> key;
+		}
 
-			key = {c, KeyMod::Alt};
-		} else if (c == 9) {
-			key = {KeyType::Tab};
-		} else if (c == 10) {
-			key = {KeyType::Enter};
-		} else if (c == 13) {
-			key = {KeyType::CarriageReturn};
-		} else if (0 < c && c < 27) {
-			// 1..26 corresponds to ^a..^z.
-			key = {uchar(KeyType::a) + c - 1, KeyMod::Ctrl};
+		++pendingIndex;
+		if (MouseReport *report = std::get_if<MouseReport>(&event)) {
+			dispatchMouse(*report);
+			key = KeyType::Mouse;
 		} else {
-			key = c;
+			key = std::get<Key>(event);
 		}
 
 		return *this;
@@ -568,10 +1400,43 @@ namespace Haunted {
 				dbg.restore().right(6)         << top << ") "_d;
 				dbg.restore().right(10).save() << width;
 				dbg.restore().right(3)         << " × "_d << height << ansi::endl;
-				if (UI::Container *cont = dynamic_cast<UI::Container *>(control))
+				if (UI::Container *cont = control->toContainer())
 					for (UI::Control *child: cont->getChildren())
 						queue.push_back({depth + 1, child});
 			}
 		}
 	}
+
+	void Terminal::debugMetrics() {
+		using namespace std::chrono;
+		ansi::ansistream &dbg = Haunted::dbgstream;
+		const Metrics::Snapshot snapshot = metrics.snapshot();
+
+		auto micros = [](nanoseconds duration) {
+			return std::to_string(duration_cast<microseconds>(duration).count()) + "µs";
+		};
+
+		dbg << "metrics"_b << ansi::endl;
+		dbg << "  frames "_d << snapshot.frames << ", bytes "_d << snapshot.bytes << ", sequences "_d
+			<< snapshot.sequences << ansi::endl;
+		dbg << "  last frame "_d << snapshot.lastBytes << " bytes, "_d << snapshot.lastSequences << " sequences"_d
+			<< ansi::endl;
+		dbg << "  latency p50 "_d << micros(snapshot.p50) << ", p99 "_d << micros(snapshot.p99) << ansi::endl;
+
+		const std::pair<const char *, Metrics::Snapshot::Lock> locks[] {
+			{"render", snapshot.renderLock}, {"output", snapshot.outputLock}, {"lines", snapshot.lineLock}};
+
+		for (const auto &[name, lock]: locks)
+			dbg << "  " << name << " lock "_d << lock.acquisitions << " acquired, "_d << lock.contended
+				<< " contended, "_d << micros(lock.wait) << " waited, "_d << micros(lock.maxWait) << " max"_d
+				<< ansi::endl;
+
+		dbg << "  input queue "_d << inputQueue.depth() << " waiting, "_d << inputQueue.maxDepth << " max, "_d
+			<< inputQueue.stalls << " stalls, latency p50 "_d << micros(inputQueue.latency.percentile(0.5)) << ", p99 "_d
+			<< micros(inputQueue.latency.percentile(0.99)) << ansi::endl;
+
+		for (const DrawStats &draw: snapshot.draws)
+			dbg << "  " << draw.id << ": "_d << draw.draws << " draws, "_d << micros(draw.total) << " total, "_d
+				<< micros(draw.max) << " max"_d << ansi::endl;
+	}
 }
@@ -1,21 +1,34 @@
 // #define NODEBUG
 
+#include <cstdio>
+#include <deque>
 #include <cstdlib>
+#include <ctime>
 #include <iomanip>
 #include <iostream>
 #include <string>
+#include <thread>
 #include <vector>
 #include <utility>
 
 #include <cassert>
+#include <csignal>
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/epoll.h>
 
 #include "lib/formicine/ansi.h"
 #include "haunted/tests/Test.h"
 #include "haunted/core/CSI.h"
 #include "haunted/core/DummyTerminal.h"
+#include "haunted/core/EventLoop.h"
+#include "haunted/core/EventQueue.h"
+#include "haunted/core/Keymap.h"
+#include "haunted/core/HeadlessTerminal.h"
+#include "haunted/core/InputDecoder.h"
+#include "haunted/core/OutputQueue.h"
 #include "haunted/core/Key.h"
+#include "haunted/core/Screen.h"
 #include "haunted/core/Util.h"
 #include "haunted/core/Terminal.h"
 #include "haunted/ui/boxes/SimpleBox.h"
@@ -156,7 +169,7 @@ namespace Haunted::Tests {
 		using namespace Haunted::UI::Boxes;
 
 		term.cbreak();
-		VectorBox *tb  = new VectorBox();             tb->setName("tb");
+		VectorBox *tb  = new VectorBox(nullptr);      tb->setName("tb");
 		TextInput *ti  = new TextInput();             ti->setName("ti");
 		Label     *tlb = new Label("Title",  false); tlb->setName("tlb");
 		Label     *slb = new Label("Status", false); slb->setName("slb");
@@ -329,7 +342,7 @@ namespace Haunted::Tests {
 		}, &VectorBox::lineAtRow, tb, "lineAtRow");
 
 		unit.check("lineAtRow(" + std::to_string(rows) + ")", typeid(std::out_of_range), "Invalid row index: " +
-			std::to_string(rows), tb, &VectorBox::lineAtRow, rows);
+			std::to_string(rows), tb, &VectorBox::lineAtRow, size_t(rows));
 
 		unit.check({
 			{{0, true}, "Hello               "},
@@ -367,7 +380,7 @@ namespace Haunted::Tests {
 		unit.check(tb->nextRow(), -1, "nextRow()");
 		INFO("Resetting textbox.");
 		tb->clearLines();
-		unit.check("lineAtRow(0)", typeid(std::out_of_range), "Invalid row index: 0", tb, &VectorBox::lineAtRow, 0);
+		unit.check("lineAtRow(0)", typeid(std::out_of_range), "Invalid row index: 0", tb, &VectorBox::lineAtRow, size_t(0));
 		unit.check(tb->voffset, 0, "voffset");
 		unit.check(tb->totalRows(), 0, "totalRows()");
 		// unit.check(tb->effective_voffset(), 0, "effective_voffset()");
@@ -528,6 +541,977 @@ namespace Haunted::Tests {
 
 		ansi::out << ansi::endl;
 	}
+
+	void maintest::unittest_screen(Testing &unit) {
+		INFO(wrap("Testing Haunted::Screen.\n", ansi::style::bold));
+
+		Screen back(10, 3), front;
+		back.feed("\e[2;3Hfoo\e[1;31mbar");
+		unit.check(back.rowText(1), std::string("  foobar  "), "rowText(1)");
+		unit.check(back.at(5, 1).foreground, int16_t(1), "at(5, 1).foreground");
+		unit.check(int(back.at(5, 1).attributes), int(Cell::Bold), "at(5, 1).attributes");
+
+		INFO("Diffing against an empty front buffer.");
+		back.diff(front);
+		unit.check(front.rowText(1), back.rowText(1), "front.rowText(1)");
+		unit.check(back.diff(front), std::string(), "diff() without changes");
+
+		INFO("Changing one cell.");
+		back.feed("\e[0m\e[2;4HX\e[H");
+		unit.check(back.diff(front), std::string("\e[4G\e[0mX\e[H"), "diff() with one change");
+
+		INFO("Planning cursor movement.");
+		unit.check(front.planMove(Cell(), -1, -1, 4, 1), std::string("\e[2;5H"), "planMove(unknown → 4, 1)");
+		unit.check(front.planMove(Cell(), 0, 0, 0, 2), std::string("\n\n"), "planMove(0, 0 → 0, 2)");
+		unit.check(front.planMove(Cell(), 9, 1, 1, 1), std::string("\r "), "planMove(9, 1 → 1, 1)");
+		unit.check(front.planMove(Cell(), 5, 2, 5, 1), std::string("\eM"), "planMove(5, 2 → 5, 1)");
+		unit.check(front.planMove(Cell(), 0, 1, 3, 1), std::string("  f"), "planMove(0, 1 → 3, 1)");
+
+		INFO("Scrolling within margins.");
+		back.feed("\e[2;3r\e[3;1Hline\nnext");
+		unit.check(back.rowText(1), std::string("line      "), "rowText(1)");
+		unit.check(back.rowText(2), std::string("next      "), "rowText(2)");
+		unit.check(back.rowText(0), std::string("          "), "rowText(0)");
+
+		INFO("Wrapping a doublewide character.");
+		back.feed("\e[r\e[1;10H中");
+		unit.check(back.rowText(0), std::string("          "), "rowText(0)");
+		unit.check(back.rowText(1).substr(0, 3), std::string("中"), "rowText(1)");
+		unit.check(back.at(1, 1).glyph, std::string(), "at(1, 1).glyph");
+
+		INFO("Erasing and repeating.");
+		Screen eraser(6, 3);
+		eraser.feed("abcdef\e[2;1Hx\e[4b\e[3;1Hghijkl");
+		unit.check(eraser.rowText(1), std::string("xxxxx "), "rowText(1) after REP");
+		eraser.feed("\e[1;2H\e[3X");
+		unit.check(eraser.rowText(0), std::string("a   ef"), "rowText(0) after ECH");
+		eraser.feed("\e[2;2;3;4$z");
+		unit.check(eraser.rowText(1), std::string("x   x "), "rowText(1) after DECERA");
+		unit.check(eraser.rowText(2), std::string("g   kl"), "rowText(2) after DECERA");
+
+		INFO("Detecting scrolled rows.");
+		Screen scroller(10, 4), scroller_front;
+		scroller.feed("aaaaaaaaaa\e[2;1Hbbbbbbbbbb\e[3;1Hcccccccccc\e[4;1Hdddddddddd\e[H");
+		scroller.diff(scroller_front);
+		scroller.feed("\e[S\e[4;1Heeeeeeeeee\e[H");
+		unit.check(scroller.diff(scroller_front), std::string("\e[1;4r\e[S\e[r\n\n\neeeeeeeeee\e[H"), "diff() after SU");
+		unit.check(scroller_front.rowText(0), std::string("bbbbbbbbbb"), "front.rowText(0)");
+		scroller.feed("\e[2T\e[1;1Hxxxxxxxxxx\e[2;1Hyyyyyyyyyy\e[H");
+		unit.check(scroller.diff(scroller_front), std::string("\e[1;4r\e[2T\e[rxxxxxxxxxx\e[2Hyyyyyyyyyy\e[H"),
+			"diff() after SD");
+		unit.check(scroller_front.rowText(3), std::string("cccccccccc"), "front.rowText(3)");
+
+		unit.check(Screen::transition(Cell(), Cell()), std::string(), "transition(default, default)");
+		Cell styled;
+		styled.foreground = 12;
+		styled.background = 200;
+		styled.attributes = Cell::Underline;
+		unit.check(Screen::transition(Cell(), styled), std::string("\e[4;94;48;5;200m"), "transition(default, styled)");
+		unit.check(Screen::transition(styled, Cell()), std::string("\e[0m"), "transition(styled, default)");
+
+		ansi::out << ansi::endl;
+	}
+
+	void maintest::unittest_headless(Testing &unit) {
+		using namespace Haunted::UI;
+		INFO(wrap("Testing Haunted::HeadlessTerminal.\n", ansi::style::bold));
+
+		HeadlessTerminal headless(20, 3);
+		Boxes::SimpleBox *wrapper = new Boxes::SimpleBox(&headless);
+		VectorBox *tb = new VectorBox(wrapper, {0, 0, 20, 3});
+		tb->setAutoscroll(true);
+		headless.setRoot(wrapper);
+		wrapper->resize({0, 0, 20, 3});
+
+		SimpleLine<std::vector> first("First line."), second("A line long enough to wrap.", 2), third("Third.");
+		*tb += first;
+		*tb += second;
+		unit.check(headless.dump(), std::string("First line.         \nA line long enough t\n  o wrap.           \n"),
+			"dump() after adding lines");
+		unit.check(headless.getLastStats().frames, size_t(1), "getLastStats().frames");
+		unit.check(0 < headless.getLastStats().sequences, true, "0 < getLastStats().sequences");
+
+		headless.setBuffered(true);
+		headless.redraw();
+		const size_t full = headless.getLastStats().bytes;
+		*tb += third;
+		unit.check(headless.getScreen().rowText(0), std::string("A line long enough t"), "rowText(0) after scrolling");
+		unit.check(headless.getScreen().rowText(2), std::string("Third.              "), "rowText(2) after scrolling");
+		unit.check(headless.getLastStats().bytes < full, true, "scrolling costs less than redrawing");
+
+		INFO("Switching to buffered output after drawing with margins.");
+		HeadlessTerminal margined(20, 3);
+		Boxes::SimpleBox *margined_wrapper = new Boxes::SimpleBox(&margined);
+		VectorBox *margined_tb = new VectorBox(margined_wrapper, {0, 0, 20, 3});
+		margined.setRoot(margined_wrapper);
+		margined_wrapper->resize({0, 0, 20, 3});
+		margined.claimMargins(0, 2, 5, 9);
+		margined.jump(0, 0);
+		margined << "Inside";
+		margined.releaseMargins();
+		margined.setBuffered(true);
+		*margined_tb += "A line wider than 10.";
+		margined.redraw();
+		unit.check(margined.getScreen().rowText(0), std::string("A line wider than 10"),
+			"rowText(0) after switching to buffered");
+		unit.check(margined.getScreen().rowText(1), std::string(".                   "),
+			"rowText(1) after switching to buffered");
+
+		INFO("Clearing the rest of a text input that doesn't reach the right edge.");
+		HeadlessTerminal input_term(20, 3);
+		Boxes::SimpleBox *input_wrapper = new Boxes::SimpleBox(&input_term);
+		input_term.setRoot(input_wrapper);
+		input_wrapper->resize({0, 0, 20, 3});
+		input_term.jump(0, 1);
+		input_term << std::string(20, 'X');
+		TextInput *input = new TextInput(input_wrapper, Position {5, 1, 10, 1}, "hi");
+		input->draw();
+		unit.check(input_term.getScreen().rowText(1), std::string("XXXXXhi        XXXXX"),
+			"rowText(1) after drawing input");
+
+		INFO("Committing a frame from another thread while one is in progress.");
+		HeadlessTerminal shared(20, 3);
+		{
+			Terminal::Frame frame(&shared);
+			shared.claimMargins(0, 2, 5, 14);
+			shared.jump(0, 0);
+			shared << "Inside";
+			std::thread([&shared] {
+				Terminal::Frame other(&shared);
+				shared.jump(0, 2);
+				shared << "Other";
+			}).join();
+			unit.check(shared.getScreen().rowText(0), std::string(20, ' '), "rowText(0) before committing");
+			unit.check(shared.getScreen().rowText(2), std::string("Other               "),
+				"rowText(2) before committing");
+			shared.releaseMargins();
+		}
+		unit.check(shared.getScreen().rowText(0), std::string("     Inside         "), "rowText(0) after committing");
+
+		ansi::out << ansi::endl;
+	}
+
+	void maintest::unittest_outputqueue(Testing &unit) {
+		INFO(wrap("Testing Haunted::OutputQueue.\n", ansi::style::bold));
+
+		OutputQueue queue(4);
+		unit.check(queue.tryPush({"a"}), true, "tryPush(\"a\")");
+		OutputQueue::Chunk chunk;
+		unit.check(queue.tryPop(chunk), true, "tryPop()");
+		unit.check(chunk.data, std::string("a"), "popped chunk");
+		unit.check(queue.tryPop(chunk), false, "tryPop() when empty");
+
+		for (int i = 0; i < 4; ++i)
+			queue.push({std::to_string(i)});
+		unit.check(queue.tryPush({"4"}), false, "tryPush() when full");
+
+		INFO("Pushing from several threads.");
+		constexpr int producers = 4, count = 10'000;
+		std::vector<std::thread> threads;
+		for (int producer = 0; producer < producers; ++producer)
+			threads.emplace_back([&queue, producer] {
+				for (int i = 0; i < count; ++i)
+					queue.push({std::to_string(producer) + ":" + std::to_string(i)});
+			});
+
+		std::vector<int> next(producers, 0);
+		bool ordered = true;
+		for (int popped = 0; popped < producers * count + 4;) {
+			if (!queue.tryPop(chunk)) {
+				std::this_thread::yield();
+				continue;
+			}
+			++popped;
+			const size_t colon = chunk.data.find(':');
+			if (colon == std::string::npos)
+				continue;
+			const int producer = std::stoi(chunk.data.substr(0, colon));
+			ordered = ordered && std::stoi(chunk.data.substr(colon + 1)) == next[producer]++;
+		}
+
+		for (std::thread &thread: threads)
+			thread.join();
+
+		unit.check(ordered, true, "each producer's chunks arrive in order");
+		unit.check(next == std::vector<int>(producers, count), true, "every chunk was received");
+
+		ansi::out << ansi::endl;
+	}
+
+	void maintest::unittest_metrics(Testing &unit) {
+		using namespace Haunted::UI;
+		using namespace std::chrono_literals;
+		INFO(wrap("Testing Haunted::Metrics.\n", ansi::style::bold));
+
+		LatencyHistogram histogram;
+		for (int i = 1; i <= 100; ++i)
+			histogram.record(i * 1us);
+		const auto p50 = histogram.percentile(0.5), p99 = histogram.percentile(0.99);
+		unit.check(histogram.count(), uint64_t(100), "count()");
+		unit.check(50us <= p50 && p50 < 57us, true, "50µs <= percentile(0.5) < 57µs");
+		unit.check(99us <= p99 && p99 < 112us, true, "99µs <= percentile(0.99) < 112µs");
+
+		HeadlessTerminal headless(20, 3);
+		Label *label = new Label(&headless, {0, 0, 20, 1}, "Hello");
+		headless.setRoot(label);
+		label->setText("Goodbye");
+
+		const Metrics::Snapshot snapshot = headless.metrics.snapshot();
+		unit.check(snapshot.frames, uint64_t(2), "frames");
+		unit.check(snapshot.lastBytes, uint64_t(headless.getLastFrame().bytes), "lastBytes");
+		unit.check(0 < snapshot.lastSequences, true, "0 < lastSequences");
+		unit.check(0 < snapshot.p50.count(), true, "0 < p50");
+		unit.check(snapshot.draws.size(), size_t(1), "draws.size()");
+		if (!snapshot.draws.empty())
+			unit.check(snapshot.draws.front().draws, uint64_t(2), "draws.front().draws");
+		unit.check(0 < snapshot.renderLock.acquisitions, true, "0 < renderLock.acquisitions");
+
+		ansi::out << ansi::endl;
+	}
+
+	void maintest::unittest_inputdecoder(Testing &unit) {
+		INFO(wrap("Testing Haunted::InputDecoder.\n", ansi::style::bold));
+
+		InputDecoder decoder;
+		std::vector<InputDecoder::Event> events;
+		auto key_at = [&](size_t index) {
+			return index < events.size() && std::holds_alternative<Key>(events[index])?
+				std::get<Key>(events[index]) : Key(-1);
+		};
+
+		decoder.feed("a\x01\t\e[A\e[1;5C\e[3~\e[Z\eb", events);
+		unit.check(events.size(), size_t(8), "events.size()");
+		unit.check(key_at(0) == Key('a'), true, "plain character");
+		unit.check(key_at(1) == Key(KeyType::a, KeyMod::Ctrl), true, "^a");
+		unit.check(key_at(2) == Key(KeyType::Tab), true, "tab");
+		unit.check(key_at(3) == Key(KeyType::UpArrow), true, "up arrow");
+		unit.check(key_at(4) == Key(KeyType::RightArrow, KeyMod::Ctrl), true, "ctrl+right arrow");
+		unit.check(key_at(5) == Key(KeyType::Del), true, "delete");
+		unit.check(key_at(6) == Key(KeyType::Tab).shift(), true, "shift+tab");
+		unit.check(key_at(7) == Key('b', KeyMod::Alt), true, "alt+b");
+
+		INFO("Decoding sequences split across chunks.");
+		events.clear();
+		decoder.feed("\e[97;", events);
+		unit.check(decoder.partial(), true, "partial() in the middle of a sequence");
+		decoder.feed("3u\e[<0;5;", events);
+		decoder.feed("7M\e[<0;5;7m", events);
+		unit.check(events.size(), size_t(3), "events.size()");
+		unit.check(key_at(0) == Key('a', KeyMod::Alt), true, "CSI u alt+a");
+		const MouseReport *report = events.size() < 2? nullptr : std::get_if<MouseReport>(&events[1]);
+		unit.check(report != nullptr && report->action == MouseAction::Down && report->x == 4 && report->y == 6, true,
+			"mouse down at 4, 6");
+		report = events.size() < 3? nullptr : std::get_if<MouseReport>(&events[2]);
+		unit.check(report != nullptr && report->action == MouseAction::Up, true, "mouse up");
+
+		INFO("Ignoring unknown sequences.");
+		events.clear();
+		decoder.feed("\e[99~\e[?1;2c\e\ex", events);
+		unit.check(events.size(), size_t(2), "events.size()");
+		unit.check(key_at(0) == Key(KeyType::Escape), true, "double escape");
+		unit.check(key_at(1) == Key('x', KeyMod::Alt), true, "alt+x after the double escape");
+
+		INFO("Resolving partial sequences after a timeout.");
+		events.clear();
+		decoder.feed("\e", events);
+		decoder.flush(events);
+		decoder.feed("\e[", events);
+		decoder.flush(events);
+		decoder.feed("\e[1;", events);
+		decoder.flush(events);
+		unit.check(decoder.partial(), false, "partial() after flush");
+		unit.check(events.size(), size_t(2), "events.size()");
+		unit.check(key_at(0) == Key(KeyType::Escape), true, "lone escape");
+		unit.check(key_at(1) == Key('[', KeyMod::Alt), true, "lone alt+[");
+
+		int fds[2];
+		if (pipe(fds) < 0)
+			throw std::runtime_error("pipe failed");
+
+		HeadlessTerminal term(80, 24);
+		term.inFd = fds[0];
+
+		Key key;
+		if (::write(fds[1], "\e", 1) == 1)
+			term >> key;
+		unit.check(key == Key(KeyType::Escape), true, "escape key read from a pipe");
+		if (::write(fds[1], "\e[B", 3) == 3)
+			term >> key;
+		unit.check(key == Key(KeyType::DownArrow), true, "down arrow read from a pipe");
+		::close(fds[0]);
+		::close(fds[1]);
+
+		INFO("Decoding bracketed pastes.");
+		events.clear();
+		decoder.feed("x\e[200~one\e[B\r", events);
+		unit.check(decoder.partial(), true, "partial() in the middle of a paste");
+		decoder.feed("two\e[2", events);
+		decoder.feed("01~y", events);
+		const InputDecoder::Paste *paste = events.size() < 2? nullptr : std::get_if<InputDecoder::Paste>(&events[1]);
+		unit.check(events.size(), size_t(3), "events.size()");
+		unit.check(paste? paste->text : std::string(), std::string("one\e[B\rtwo"), "pasted text");
+		unit.check(key_at(2) == Key('y'), true, "key after the paste");
+
+		UI::TextInput *input = new UI::TextInput(&term);
+		term.setRoot(input);
+		input->focus();
+		term.sendPaste("hello\x01 world");
+		unit.check(input->getText(), std::string("hello world"), "TextInput text after a paste");
+		unit.check(input->getCursor(), size_t(11), "TextInput cursor after a paste");
+
+		HeadlessTerminal rootless(80, 24);
+		size_t keys_sent = 0;
+		rootless.keyPostlistener = [&](const Key &) { ++keys_sent; };
+		rootless.sendPaste("ab\e[A");
+		unit.check(keys_sent, size_t(3), "unhandled paste sent as keys");
+
+		INFO("Coalescing mouse reports.");
+		if (pipe(fds) < 0)
+			throw std::runtime_error("pipe failed");
+		HeadlessTerminal mouse_term(20, 3);
+		UI::Boxes::SimpleBox *wrapper = new UI::Boxes::SimpleBox(&mouse_term);
+		new UI::VectorBox(wrapper, {0, 0, 20, 3});
+		mouse_term.setRoot(wrapper);
+		wrapper->resize({0, 0, 20, 3});
+		mouse_term.inFd = fds[0];
+		std::vector<MouseReport> reports;
+		mouse_term.mousePostlistener = [&](const MouseReport &report) { reports.push_back(report); };
+		const std::string motion = "\e[<35;1;1M\e[<35;2;1M\e[<35;3;1M\e[<65;1;1M\e[<65;1;1M\e[<64;1;1M\e[<65;1;1M"
+			"\e[<0;1;1M";
+		if (::write(fds[1], motion.data(), motion.size()) == ssize_t(motion.size()))
+			for (int i = 0; i < 3; ++i)
+				mouse_term >> key;
+		unit.check(reports.size(), size_t(3), "reports.size()");
+		if (reports.size() == 3) {
+			unit.check(reports[0].action == MouseAction::Move && reports[0].x == 2, true, "latest motion");
+			unit.check(reports[1].action == MouseAction::ScrollDown && reports[1].count == 2, true, "net scroll");
+			unit.check(reports[2].action == MouseAction::Down, true, "press after scrolling");
+		}
+		::close(fds[0]);
+		::close(fds[1]);
+
+		ansi::out << ansi::endl;
+	}
+
+	void maintest::unittest_eventloop(Testing &unit) {
+		using namespace std::chrono_literals;
+		INFO(wrap("Testing Haunted::EventLoop.\n", ansi::style::bold));
+
+		EventLoop loop;
+		int fds[2];
+		if (pipe(fds) < 0)
+			throw std::runtime_error("pipe failed");
+
+		std::string received;
+		loop.watch(fds[0], EPOLLIN, [&](uint32_t) {
+			char buffer[16];
+			const ssize_t count = ::read(fds[0], buffer, sizeof(buffer));
+			if (0 < count)
+				received.append(buffer, count);
+		});
+
+		int fired = 0, ticks = 0;
+		loop.addTimer(1ms, 0ms, [&] { ++fired; });
+		const int ticker = loop.addTimer(1ms, 1ms, [&] { ++ticks; });
+
+		std::thread poster([&] {
+			if (::write(fds[1], "hi", 2) < 0)
+				return;
+			std::this_thread::sleep_for(20ms);
+			loop.post([&] { loop.stop(); });
+		});
+
+		loop.run();
+		poster.join();
+		loop.cancelTimer(ticker);
+
+		unit.check(received, std::string("hi"), "data read from a pipe");
+		unit.check(fired, 1, "one-shot timer fired once");
+		unit.check(1 < ticks, true, "repeating timer fired repeatedly");
+
+		INFO("Handling a signal.");
+		bool signaled = false;
+		loop.watchSignal(SIGUSR1, [&] { signaled = true; });
+		raise(SIGUSR1);
+		loop.runOnce(100);
+		loop.unwatchSignal(SIGUSR1);
+		unit.check(signaled, true, "SIGUSR1 handled on the loop");
+
+		::close(fds[0]);
+		::close(fds[1]);
+		ansi::out << ansi::endl;
+	}
+
+	void maintest::unittest_eventqueue(Testing &unit) {
+		INFO(wrap("Testing Haunted::EventQueue.\n", ansi::style::bold));
+
+		EventQueue queue(4);
+		for (char ch = 'a'; ch < 'e'; ++ch)
+			queue.tryPush(Key(ch));
+		unit.check(queue.tryPush(Key('e')), false, "tryPush() on a full queue");
+		unit.check(queue.depth(), size_t(4), "depth() when full");
+
+		std::atomic<bool> keep_going = true;
+		std::string popped;
+		std::thread producer([&] {
+			for (char ch = 'e'; ch <= 'z'; ++ch)
+				queue.push(Key(ch), keep_going);
+		});
+
+		InputDecoder::Event event;
+		while (popped.size() < 26)
+			if (queue.tryPop(event))
+				popped += char(std::get<Key>(event));
+		producer.join();
+
+		unit.check(popped, std::string("abcdefghijklmnopqrstuvwxyz"), "events popped in order");
+		unit.check(queue.latency.count(), uint64_t(26), "latency.count()");
+		unit.check(queue.maxDepth.load(), size_t(4), "maxDepth");
+
+		INFO("Dispatching input on the calling thread.");
+		int fds[2];
+		if (pipe(fds) < 0)
+			throw std::runtime_error("pipe failed");
+
+		std::istringstream no_input;
+		std::ostringstream no_output;
+		ansi::ansistream no_stream(no_output, no_output);
+		Terminal term(no_input, no_stream, 24, 80);
+		term.inFd = fds[0];
+
+		std::string received;
+		bool same_thread = true;
+		const std::thread::id main_thread = std::this_thread::get_id();
+		term.keyPostlistener = [&](const Key &key) {
+			received += char(key);
+			same_thread = same_thread && std::this_thread::get_id() == main_thread;
+		};
+
+		term.startInput(false);
+		if (::write(fds[1], "hi\x03", 3) == 3)
+			while (term.dispatchInput())
+				std::this_thread::yield();
+		term.join();
+
+		unit.check(received, std::string("hi"), "keys dispatched before ^c");
+		unit.check(same_thread, true, "keys dispatched on the calling thread");
+		::close(fds[0]);
+		::close(fds[1]);
+
+		INFO("Handling a window resize on the input thread.");
+		struct ResizeTerminal: Terminal {
+			using Terminal::Terminal;
+			std::atomic<bool> resized = false;
+			std::thread::id resizeThread;
+			void winch(int, int) override {
+				resizeThread = std::this_thread::get_id();
+				resized = true;
+			}
+		};
+
+		if (pipe(fds) < 0)
+			throw std::runtime_error("pipe failed");
+
+		ResizeTerminal resize_term(no_input, no_stream, 24, 80);
+		resize_term.inFd = fds[0];
+		resize_term.watchSize();
+		resize_term.startInput(false);
+		std::raise(SIGWINCH);
+		for (int i = 0; i < 1000 && !resize_term.resized; ++i)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		resize_term.stopInput();
+
+		unit.check(resize_term.resized.load(), true, "winch() called after SIGWINCH");
+		unit.check(resize_term.resizeThread != main_thread, true, "winch() called on the input thread");
+		::close(fds[0]);
+		::close(fds[1]);
+		ansi::out << ansi::endl;
+	}
+
+	void maintest::unittest_keymap(Testing &unit) {
+		INFO(wrap("Testing Haunted::Keymap.\n", ansi::style::bold));
+
+		const Key ctrl_x(KeyType::x, KeyMod::Ctrl), ctrl_s(KeyType::s, KeyMod::Ctrl);
+		unit.check(Key('x').pack() != ctrl_x.pack(), true, "modifiers change the packed key");
+		unit.check(std::string(Key(KeyType::UpArrow, KeyMod::Ctrl)), std::string("⌃↑"), "string of ^↑");
+
+		Keymap keymap;
+		std::string log;
+		keymap.bind(Key('q'), [&](const Key &) { log += "quit "; return true; });
+		keymap.bind({ctrl_x, ctrl_s}, [&](const Key &) { log += "save "; return true; });
+		keymap.bind({ctrl_x, Key('k')}, [&](const Key &) { return false; });
+
+		unit.check(keymap.feed(Key('q')) == Keymap::Match::Full, true, "single key");
+		unit.check(keymap.feed(ctrl_x) == Keymap::Match::Partial, true, "start of a chord");
+		unit.check(keymap.pending(), true, "pending() in a chord");
+		unit.check(keymap.feed(ctrl_s) == Keymap::Match::Full, true, "end of a chord");
+		unit.check(keymap.feed(ctrl_s) == Keymap::Match::None, true, "end of a chord by itself");
+		keymap.feed(ctrl_x);
+		unit.check(keymap.feed(Key('q')) == Keymap::Match::Full, true, "abandoning a chord for another binding");
+		keymap.feed(ctrl_x);
+		unit.check(keymap.feed(Key('k')) == Keymap::Match::None, true, "a binding that declines the key");
+		unit.check(log, std::string("quit save quit "), "actions called");
+
+		INFO("Rebinding at runtime.");
+		keymap.bind(Key('q'), [&](const Key &) { log = "rebound"; return true; });
+		keymap.feed(Key('q'));
+		unit.check(log, std::string("rebound"), "rebound action");
+		unit.check(keymap.unbind({ctrl_x, ctrl_s}), true, "unbind() on a chord");
+		unit.check(keymap.bound({ctrl_x, ctrl_s}), false, "bound() after unbinding");
+		unit.check(keymap.bound({ctrl_x, Key('k')}), true, "sibling chord still bound");
+		unit.check(keymap.unbind(Key('z')), false, "unbind() on an unbound key");
+
+		INFO("Rejecting conflicting bindings.");
+		unit.check("bind(^x)", typeid(std::invalid_argument), "", std::function<bool()>([&] {
+			keymap.bind(ctrl_x, [](const Key &) { return true; });
+			return true;
+		}));
+		unit.check("bind(q w)", typeid(std::invalid_argument), "", std::function<bool()>([&] {
+			keymap.bind({Key('q'), Key('w')}, [](const Key &) { return true; });
+			return true;
+		}));
+		unit.check(keymap.bound(ctrl_x), false, "bound() on a rejected prefix");
+		unit.check(keymap.bound({Key('q'), Key('w')}), false, "bound() on a rejected chord");
+		unit.check(keymap.feed(ctrl_x) == Keymap::Match::Partial, true, "chord still reachable after a rejection");
+		keymap.reset();
+
+		HeadlessTerminal term(20, 2);
+		bool quit = false;
+		term.keymap->bind(Key(KeyType::q, KeyMod::Ctrl), [&](const Key &) { return quit = true; });
+		unit.check(term.handleKey(Key(KeyType::q, KeyMod::Ctrl)) && quit, true, "binding added to a terminal");
+		unit.check(term.handleKey(Key(KeyType::l, KeyMod::Ctrl)), true, "default ^l binding");
+		unit.check(term.onKey(Key(KeyType::y, KeyMod::Ctrl)), true, "onKey() with the default ^y binding");
+		unit.check(term.onKey(Key(KeyType::t, KeyMod::Ctrl)), false, "onKey() with an unbound key");
+
+		ansi::out << ansi::endl;
+	}
+
+	void maintest::unittest_bubblepath(Testing &unit) {
+		using namespace Haunted::UI;
+		INFO(wrap("Testing Haunted::UI::Control::bubblePath.\n", ansi::style::bold));
+
+		HeadlessTerminal term(20, 5);
+		std::vector<Boxes::SimpleBox *> boxes {new Boxes::SimpleBox(&term, {0, 0, 20, 5})};
+		term.setRoot(boxes.front());
+		for (int i = 1; i < 12; ++i) {
+			boxes.push_back(new Boxes::SimpleBox(boxes.back(), {0, 0, 20, 5}));
+			boxes[i - 1]->addChild(boxes.back());
+		}
+
+		TextInput *input = new TextInput(boxes.back(), Position {0, 0, 20, 1});
+		input->focus();
+
+		unit.check(input->bubblePath().size(), size_t(14), "bubblePath().size() under twelve boxes");
+		unit.check(input->bubblePath().back() == static_cast<InputHandler *>(&term), true, "path ends at the terminal");
+		unit.check(boxes[3]->toContainer() != nullptr && input->toContainer() == nullptr, true, "toContainer()");
+		unit.check(term.toControl() == nullptr && boxes[3]->toControl() == boxes[3], true, "toControl()");
+
+		boxes[2]->keyFunction = [](const Key &key) { return key == Key(KeyType::g, KeyMod::Ctrl); };
+		unit.check(term.sendKey(Key(KeyType::g, KeyMod::Ctrl)) == static_cast<InputHandler *>(boxes[2]), true,
+			"key handled by an ancestor");
+
+		INFO("Invalidating the path when the hierarchy changes.");
+		boxes.back()->removeChild(input);
+		input->setParent(boxes[5]);
+		unit.check(input->bubblePath().size(), size_t(8), "bubblePath().size() after moving the control");
+		unit.check(input->bubblePath()[1] == static_cast<InputHandler *>(boxes[5]), true, "new parent in the path");
+		boxes[5]->addChild(input);
+
+		ansi::out << ansi::endl;
+	}
+
+	void maintest::unittest_spatialindex(Testing &unit) {
+		using namespace Haunted::UI;
+		INFO(wrap("Testing Haunted::UI::SpatialIndex.\n", ansi::style::bold));
+
+		HeadlessTerminal term(24, 8);
+		Boxes::SimpleBox *root = new Boxes::SimpleBox(&term, {0, 0, 24, 8});
+		term.setRoot(root);
+
+		// A 6x4 grid of three-column labels with a one-column gap after each.
+		std::vector<Label *> labels;
+		for (int row = 0; row < 4; ++row)
+			for (int column = 0; column < 6; ++column)
+				labels.push_back(new Label(root, {column * 4, row * 2, 3, 2}));
+
+		auto linear = [&](int x, int y) -> Control * {
+			for (Control *child: *root) {
+				const Position &pos = child->getPosition();
+				if (pos.left <= x && x <= pos.right() && pos.top <= y && y <= pos.bottom())
+					return child;
+			}
+			return nullptr;
+		};
+
+		auto matches = [&] {
+			for (int y = -1; y <= 8; ++y)
+				for (int x = -1; x <= 24; ++x)
+					if (root->childAtOffset(x, y) != linear(x, y))
+						return false;
+			return true;
+		};
+
+		unit.check(root->childAtOffset(5, 3) == labels[7], true, "childAtOffset(5, 3)");
+		unit.check(root->childAtOffset(3, 3) == nullptr, true, "childAtOffset in a gap");
+		unit.check(root->childAtOffset(30, 3) == nullptr && root->childAtOffset(5, 9) == nullptr, true,
+			"childAtOffset outside the grid");
+		unit.check(matches(), true, "agrees with a linear scan");
+
+		INFO("Resolving overlaps in the original order.");
+		Label *wide = new Label(root, {0, 1, 24, 2});
+		unit.check(root->childAtOffset(3, 1) == wide, true, "later control in a gap");
+		unit.check(root->childAtOffset(5, 2) == labels[7], true, "earlier control over a later one");
+		unit.check(matches(), true, "agrees with a linear scan with overlaps");
+
+		INFO("Rebuilding after the layout changes.");
+		root->removeChild(wide);
+		delete wide;
+		labels[7]->resize({30, 30, 3, 2});
+		unit.check(root->childAtOffset(5, 3) == nullptr, true, "childAtOffset(5, 3) after a resize");
+		labels[0]->move(4, 2);
+		unit.check(root->childAtOffset(5, 3) == labels[0], true, "childAtOffset(5, 3) after a move");
+		unit.check(matches(), true, "agrees with a linear scan after changes");
+
+		ansi::out << ansi::endl;
+	}
+
+	void maintest::unittest_inputrecording(Testing &unit) {
+		INFO(wrap("Testing Haunted::InputRecorder.\n", ansi::style::bold));
+
+		char path[] = "/tmp/haunted-recording-XXXXXX";
+		const int file = mkstemp(path);
+		if (file < 0)
+			throw std::runtime_error("mkstemp failed");
+		::close(file);
+
+		int fds[2];
+		if (pipe(fds) < 0)
+			throw std::runtime_error("pipe failed");
+
+		std::vector<Key> recorded;
+		{
+			HeadlessTerminal term(80, 24);
+			term.inFd = fds[0];
+			term.startRecording(path);
+
+			Key key;
+			// The escape is resolved by the timeout, so the recording has to note when that happened.
+			if (::write(fds[1], "ab\e", 3) == 3)
+				for (int i = 0; i < 3; ++i)
+					if (term >> key)
+						recorded.push_back(key);
+			const std::string rest = "\e[Ax\e[<0;3;2M";
+			if (::write(fds[1], rest.data(), rest.size()) == ssize_t(rest.size()))
+				for (int i = 0; i < 3; ++i)
+					if (term >> key)
+						recorded.push_back(key);
+			term.stopRecording();
+		}
+
+		::close(fds[0]);
+		::close(fds[1]);
+
+		InputPlayback playback(path);
+		RecordedInput entry;
+		std::vector<RecordedInput::Type> types;
+		std::string bytes;
+		while (playback.next(entry)) {
+			types.push_back(entry.type);
+			bytes += entry.bytes;
+		}
+
+		unit.check(types.size(), size_t(3), "number of entries");
+		unit.check(1 < types.size() && types[1] == RecordedInput::Type::Flush, true, "flush recorded");
+		unit.check(bytes, std::string("ab\e\e[Ax\e[<0;3;2M"), "recorded bytes");
+
+		INFO("Replaying the recording.");
+		HeadlessTerminal replay_term(80, 24);
+		std::vector<Key> replayed;
+		replay_term.keyPostlistener = [&](const Key &key) { replayed.push_back(key); };
+		unit.check(replay_term.replay(path), true, "replay()");
+		unit.check(replayed.size(), recorded.size(), "number of keys replayed");
+		unit.check(replayed == recorded, true, "same keys replayed");
+
+		const auto start = std::chrono::steady_clock::now();
+		replayed.clear();
+		replay_term.replay(path, true);
+		unit.check(replay_term.escapeTimeout <= std::chrono::steady_clock::now() - start, true,
+			"replay(realtime) waits for the escape timeout");
+		unit.check(replayed.size(), recorded.size(), "number of keys replayed in real time");
+
+		std::remove(path);
+		ansi::out << ansi::endl;
+	}
+
+	void maintest::unittest_rowindex(Testing &unit) {
+		using namespace Haunted::UI;
+		INFO(wrap("Testing Haunted::UI::RowIndex.\n", ansi::style::bold));
+
+		RowIndex index;
+		std::deque<size_t> naive;
+		unsigned int seed = 21;
+		auto random = [&](size_t max) { seed = seed * 1103515245 + 12345; return size_t(seed >> 16) % max; };
+
+		// Compares every row and line with a linear scan.
+		auto matches = [&] {
+			if (index.size() != naive.size())
+				return false;
+			size_t row = 0;
+			for (size_t line = 0; line < naive.size(); ++line) {
+				if (index.rowsBefore(line) != row || index.rows(line) != naive[line])
+					return false;
+				for (size_t offset = 0; offset < naive[line]; ++offset, ++row)
+					if (index.find(row) != std::pair(line, offset))
+						return false;
+			}
+			return index.total() == row;
+		};
+
+		for (int i = 0; i < 100; ++i) {
+			naive.push_back(1 + random(5));
+			index.pushBack(naive.back());
+		}
+
+		unit.check(matches(), true, "pushBack");
+
+		for (int i = 0; i < 50; ++i) {
+			const size_t line = random(naive.size());
+			naive[line] = 1 + random(5);
+			index.set(line, naive[line]);
+		}
+
+		unit.check(matches(), true, "set");
+
+		// Enough removals to compact the tree, interleaved with additions.
+		for (int i = 0; i < 80; ++i) {
+			naive.pop_front();
+			index.popFront();
+			if (i % 4 == 0) {
+				naive.push_back(1 + random(5));
+				index.pushBack(naive.back());
+			}
+		}
+
+		unit.check(matches(), true, "popFront");
+		index.clear();
+		naive.clear();
+		unit.check(matches() && index.empty(), true, "clear");
+
+		INFO("Keeping a textbox's rows up to date.");
+		DummyTerminal dummy;
+		Boxes::SimpleBox wrapper(&dummy);
+		wrapper.resize({0, 0, 20, 10});
+		VectorBox *tb = new VectorBox(&wrapper, wrapper.getPosition());
+		size_t expected = 0;
+		for (int i = 0; i < 200; ++i) {
+			const std::string text(random(70), 'x');
+			*tb += text;
+			expected += text.size() <= 20? 1 : 1 + (text.size() - 20 + 19) / 20;
+		}
+
+		unit.check(tb->totalRows(), expected, "totalRows() after appending");
+		unit.check(tb->lineAtRow(expected - 1).first == tb->getLines().back().get(), true, "lineAtRow(last row)");
+		tb->resize({0, 0, 10, 10});
+		while (tb->rewrap(64));
+		size_t rewrapped = 0;
+		for (const VectorBox::LinePtr &line: tb->getLines())
+			rewrapped += line->numRows(10);
+		unit.check(tb->totalRows(), rewrapped, "totalRows() after resizing");
+
+		ansi::out << ansi::endl;
+	}
+
+	void maintest::unittest_scrollback(Testing &unit) {
+		using namespace Haunted::UI;
+		INFO(wrap("Testing Haunted::UI::Textbox scrollback limits.\n", ansi::style::bold));
+
+		HeadlessTerminal term(20, 5);
+		Boxes::SimpleBox *wrapper = new Boxes::SimpleBox(&term, {0, 0, 20, 5});
+		term.setRoot(wrapper);
+		DequeBox *tb = new DequeBox(wrapper, Position {0, 0, 20, 5});
+		tb->setAutoscroll(true);
+		tb->setScrollback(50);
+
+		for (int i = 0; i < 200; ++i)
+			*tb += "line " + std::to_string(i);
+
+		unit.check(tb->size(), size_t(50), "size() with a limit of 50 lines");
+		unit.check(tb->getEvicted(), size_t(150), "getEvicted()");
+		unit.check(std::string(*tb->getLines().front()), std::string("line 150"), "oldest line kept");
+		unit.check(tb->totalRows(), size_t(50), "totalRows()");
+		// Autoscrolling leaves the bottom row free, with or without a limit.
+		unit.check(tb->getVoffset(), 46, "voffset follows the newest line");
+		unit.check(term.dump().substr(0, 21), std::string("line 196            \n"), "top row of the screen");
+
+		INFO("Keeping the same lines in view while scrolled up.");
+		tb->setAutoscroll(false);
+		tb->setVoffset(10);
+		*tb += "line 200";
+		unit.check(tb->getVoffset(), 9, "voffset after evicting a line above the view");
+		unit.check(tb->lineAtRow(tb->getVoffset()).first == tb->getLines()[9].get(), true, "line at the top of the view");
+		unit.check(std::string(*tb->getLines()[9]), std::string("line 160"), "same line at the top of the view");
+
+		INFO("Limiting by bytes.");
+		const size_t before = tb->memoryUsage();
+		tb->setScrollback(0, 100);
+		unit.check(tb->size(), size_t(12), "size() with a limit of 100 bytes");
+		unit.check(tb->memoryUsage() < before, true, "memoryUsage() decreases");
+		*tb += std::string(150, 'x');
+		unit.check(tb->size(), size_t(1), "a single line over the limit is kept");
+		unit.check(tb->totalRows(), size_t(8), "totalRows() of the remaining line");
+
+		INFO("Evicting from a vector in batches.");
+		VectorBox *vb = new VectorBox(wrapper, Position {0, 0, 20, 5});
+		vb->setScrollback(80);
+		for (int i = 0; i < 81; ++i)
+			*vb += std::to_string(i);
+		unit.check(vb->size(), size_t(70), "size() after a batch");
+		unit.check(std::string(*vb->getLines().front()), std::string("11"), "oldest line kept in the vector");
+		unit.check(vb->totalRows(), size_t(70), "totalRows()");
+		wrapper->removeChild(vb);
+		delete vb;
+
+		ansi::out << ansi::endl;
+	}
+
+	void maintest::unittest_append(Testing &unit) {
+		using namespace Haunted::UI;
+		INFO(wrap("Testing Haunted::UI::Textbox::append.\n", ansi::style::bold));
+
+		std::vector<std::string> texts;
+		for (int i = 0; i < 300; ++i)
+			texts.push_back(std::to_string(i) + (i % 7 == 0? std::string(30, '.') : ""));
+
+		HeadlessTerminal single_term(20, 6), batch_term(20, 6);
+		auto make_box = [](HeadlessTerminal &term) {
+			Boxes::SimpleBox *wrapper = new Boxes::SimpleBox(&term, {0, 0, 20, 6});
+			term.setRoot(wrapper);
+			VectorBox *tb = new VectorBox(wrapper, Position {0, 0, 20, 6});
+			tb->setAutoscroll(true);
+			return tb;
+		};
+
+		VectorBox *single = make_box(single_term), *batch = make_box(batch_term);
+		for (const std::string &text: texts)
+			*single += text;
+
+		const size_t frames = batch_term.getTotalStats().frames;
+		batch->append(texts);
+
+		unit.check(batch->size(), size_t(300), "size()");
+		unit.check(batch->totalRows(), single->totalRows(), "totalRows()");
+		unit.check(batch->getVoffset(), single->getVoffset(), "voffset matches adding lines one at a time");
+		unit.check(batch_term.dump(), single_term.dump(), "screen matches adding lines one at a time");
+		unit.check(batch_term.getTotalStats().frames - frames, size_t(1), "frames drawn");
+
+		batch->appendBatch({"one", "two"});
+		unit.check(std::string(*batch->getLines().back()), std::string("two"), "appendBatch()");
+
+		INFO("Loading a large history.");
+		std::vector<std::string> history(50'000, "A line of history that doesn't need to wrap.");
+		batch->setScrollback(40'000);
+		const auto start = std::chrono::steady_clock::now();
+		batch->append(history);
+		const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() -
+			start);
+		INFO("Appended 50,000 lines in " << elapsed.count() << " ms.");
+		// Vectors evict an extra eighth of the limit at a time.
+		unit.check(batch->size(), size_t(35'000), "size() after loading with a limit");
+		unit.check(batch->totalRows(), size_t(105'000), "totalRows()");
+
+		ansi::out << ansi::endl;
+	}
+
+	void maintest::unittest_textline(Testing &unit) {
+		using namespace Haunted::UI;
+		INFO(wrap("Testing Haunted::UI::TextLine row caching.\n", ansi::style::bold));
+
+		bool wrap = true;
+		SimpleLine<std::vector> line("abcdefghij\e[1mklmnopqrst\e[0muvwxyz", 2, &wrap);
+		unit.check(line.numRows(8), size_t(4), "numRows(8)");
+		unit.check(std::string(line.rowView(8, 0)), std::string("abcdefgh"), "rowView(8, 0)");
+		unit.check(std::string(line.rowView(8, 1)), std::string("ij\e[1mklmn"), "rowView(8, 1)");
+		unit.check(std::string(line.rowView(8, 3)), std::string("\e[0muvwxyz"), "rowView(8, 3)");
+		unit.check(std::string(line.rowView(8, 4)), std::string(), "rowView past the last row");
+		unit.check(line.textAtRow(8, 2), std::string("  opqrst"), "textAtRow(8, 2)");
+		unit.check(line.textAtRow(8, 4), std::string(8, ' '), "textAtRow past the last row");
+
+		INFO("Measuring the cache.");
+		SimpleLine<std::vector> long_line(std::string(1000, 'x'), 10, &wrap);
+		const size_t before = long_line.memoryUsage();
+		unit.check(long_line.numRows(80), size_t(15), "numRows(80)");
+		unit.check(long_line.memoryUsage() - before, 15 * sizeof(uint32_t), "memory used by the cache");
+		unit.check(std::string(long_line.rowView(80, 14)), std::string(10, 'x'), "last row");
+
+		ansi::out << ansi::endl;
+	}
+
+	void maintest::unittest_rewrap(Testing &unit) {
+		using namespace Haunted::UI;
+		INFO(wrap("Testing Haunted::UI::Textbox rewrapping.\n", ansi::style::bold));
+
+		HeadlessTerminal term(40, 6);
+		Boxes::SimpleBox *wrapper = new Boxes::SimpleBox(&term, {0, 0, 40, 6});
+		term.setRoot(wrapper);
+		VectorBox *tb = new VectorBox(wrapper, Position {0, 0, 40, 6});
+		tb->rewrapTime = {};
+
+		std::vector<std::string> texts;
+		for (int i = 0; i < 5000; ++i)
+			texts.push_back(std::to_string(i) + ' ' + std::string(i % 90, '-'));
+		tb->append(texts);
+
+		// Scroll so that the view begins with line 3000.
+		size_t top_row = 0;
+		for (size_t i = 0; i < 3000; ++i)
+			top_row += tb->lineRows(*tb->getLines()[i]);
+		tb->setVoffset(top_row);
+
+		const auto top_line = [&] { return tb->lineAtRow(tb->getVoffset()); };
+		unit.check(top_line().first == tb->getLines()[3000].get(), true, "line 3000 at the top");
+
+		tb->resize({0, 0, 20, 6});
+		unit.check(tb->isRewrapping(), true, "isRewrapping() after narrowing");
+		unit.check(top_line().first == tb->getLines()[3000].get() && top_line().second == 0, true,
+			"line 3000 still at the top");
+
+		// The visible rows have to be exact even though the rows above them are only estimates.
+		VectorBox *reference = new VectorBox(wrapper, Position {0, 0, 20, 6});
+		reference->append(std::vector<std::string>(texts.begin() + 3000, texts.end()));
+		bool same = true;
+		for (size_t row = 0; row < 6; ++row)
+			same = same && tb->textAtRow(row) == reference->textAtRow(row);
+		unit.check(same, true, "visible rows rewrapped");
+
+		size_t passes = 0;
+		while (tb->rewrap(1000))
+			++passes;
+		size_t exact = 0;
+		for (const VectorBox::LinePtr &line: tb->getLines())
+			exact += line->numRows(20);
+		unit.check(passes, size_t(4), "rewrap() passes");
+		unit.check(tb->totalRows(), exact, "totalRows() after rewrapping");
+		unit.check(top_line().first == tb->getLines()[3000].get() && top_line().second == 0, true,
+			"line 3000 at the top after rewrapping");
+
+		INFO("Rewrapping in time slices.");
+		tb->resize({0, 0, 40, 6});
+		tb->draw();
+		unit.check(tb->isRewrapping(), true, "isRewrapping() after drawing without any rewrap time");
+		while (tb->rewrapFor(std::chrono::microseconds(200)));
+		exact = 0;
+		for (const VectorBox::LinePtr &line: tb->getLines())
+			exact += line->numRows(40);
+		unit.check(tb->totalRows(), exact, "totalRows() after rewrapFor()");
+		tb->resize({0, 0, 20, 6});
+		tb->rewrapTime = std::chrono::seconds(1);
+		tb->draw();
+		unit.check(tb->isRewrapping(), false, "isRewrapping() after drawing with rewrap time");
+
+		wrapper->removeChild(reference);
+		delete reference;
+		ansi::out << ansi::endl;
+	}
 }
 
 
@@ -574,7 +1558,28 @@ int main(int argc, char **argv) {
 
 		Haunted::Tests::maintest::test_key(term);
 	} else if (arg == "input") { MKTERM
+		// "input <path>" records the session so that it can be played back later with "replay <path>".
+		if (2 < argc)
+			term.startRecording(argv[2]);
+		Haunted::Tests::maintest::test_textinput(term);
+	} else if (arg == "replay") {
+		if (argc < 3) {
+			std::cerr << "Usage: " << argv[0] << " replay <recording> [realtime]\n";
+			return 1;
+		}
+
+		HeadlessTerminal term(80, 24);
 		Haunted::Tests::maintest::test_textinput(term);
+		const std::clock_t cpu_start = std::clock();
+		const auto start = std::chrono::steady_clock::now();
+		term.replay(argv[2], 3 < argc && std::string(argv[3]) == "realtime");
+		const auto elapsed = std::chrono::steady_clock::now() - start;
+		const Metrics::Snapshot snapshot = term.metrics.snapshot();
+		std::cout << "Wall time: " << std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()
+		          << " us\nCPU time:  " << (std::clock() - cpu_start) * 1'000'000 / CLOCKS_PER_SEC
+		          << " us\nFrames:    " << snapshot.frames << "\nBytes:     " << snapshot.bytes
+		          << "\nSequences: " << snapshot.sequences << "\nLatency:   p50 " << snapshot.p50.count()
+		          << " ns, p99 " << snapshot.p99.count() << " ns\n";
 	} else if (arg == "cursor") { MKTERM
 		Haunted::Tests::maintest::test_cursor(term);
 	} else if (arg == "margins") { MKTERM
@@ -591,12 +1596,61 @@ int main(int argc, char **argv) {
 		Haunted::Tests::maintest::unittest_expandobox(unit);
 	} else if (arg == "unitustring") {
 		Haunted::Tests::maintest::unittest_ustring(unit);
+	} else if (arg == "unitscreen") {
+		Haunted::Tests::maintest::unittest_screen(unit);
+		Haunted::Tests::maintest::unittest_headless(unit);
+	} else if (arg == "unitheadless") {
+		Haunted::Tests::maintest::unittest_headless(unit);
+	} else if (arg == "unitoutputqueue") {
+		Haunted::Tests::maintest::unittest_outputqueue(unit);
+	} else if (arg == "unitmetrics") {
+		Haunted::Tests::maintest::unittest_metrics(unit);
+	} else if (arg == "unitinputdecoder") {
+		Haunted::Tests::maintest::unittest_inputdecoder(unit);
+	} else if (arg == "uniteventloop") {
+		Haunted::Tests::maintest::unittest_eventloop(unit);
+	} else if (arg == "uniteventqueue") {
+		Haunted::Tests::maintest::unittest_eventqueue(unit);
+	} else if (arg == "unitkeymap") {
+		Haunted::Tests::maintest::unittest_keymap(unit);
+	} else if (arg == "unitbubblepath") {
+		Haunted::Tests::maintest::unittest_bubblepath(unit);
+	} else if (arg == "unitspatialindex") {
+		Haunted::Tests::maintest::unittest_spatialindex(unit);
+	} else if (arg == "unitinputrecording") {
+		Haunted::Tests::maintest::unittest_inputrecording(unit);
+	} else if (arg == "unitrowindex") {
+		Haunted::Tests::maintest::unittest_rowindex(unit);
+	} else if (arg == "unitscrollback") {
+		Haunted::Tests::maintest::unittest_scrollback(unit);
+	} else if (arg == "unitappend") {
+		Haunted::Tests::maintest::unittest_append(unit);
+	} else if (arg == "unittextline") {
+		Haunted::Tests::maintest::unittest_textline(unit);
+	} else if (arg == "unitrewrap") {
+		Haunted::Tests::maintest::unittest_rewrap(unit);
 	} else if (arg == "unit") {
 		ansi::out << ansi::endl;
 		Haunted::Tests::maintest::unittest_csiu(unit);
 		Haunted::Tests::maintest::unittest_textbox(unit);
 		Haunted::Tests::maintest::unittest_expandobox(unit);
 		Haunted::Tests::maintest::unittest_ustring(unit);
+		Haunted::Tests::maintest::unittest_screen(unit);
+		Haunted::Tests::maintest::unittest_headless(unit);
+		Haunted::Tests::maintest::unittest_outputqueue(unit);
+		Haunted::Tests::maintest::unittest_metrics(unit);
+		Haunted::Tests::maintest::unittest_inputdecoder(unit);
+		Haunted::Tests::maintest::unittest_eventloop(unit);
+		Haunted::Tests::maintest::unittest_eventqueue(unit);
+		Haunted::Tests::maintest::unittest_keymap(unit);
+		Haunted::Tests::maintest::unittest_bubblepath(unit);
+		Haunted::Tests::maintest::unittest_spatialindex(unit);
+		Haunted::Tests::maintest::unittest_inputrecording(unit);
+		Haunted::Tests::maintest::unittest_rowindex(unit);
+		Haunted::Tests::maintest::unittest_scrollback(unit);
+		Haunted::Tests::maintest::unittest_append(unit);
+		Haunted::Tests::maintest::unittest_textline(unit);
+		Haunted::Tests::maintest::unittest_rewrap(unit);
 	} else {
 		Haunted::Tests::maintest::unittest_textbox(unit);
 	}
@@ -2,6 +2,8 @@
 #include "haunted/ui/Child.h"
 
 namespace Haunted::UI {
+	std::atomic<uint64_t> Child::hierarchyVersion {1};
+
 	Container * Child::getParent() {
 		return parent;
 	}
@@ -14,9 +16,11 @@ namespace Haunted::UI {
 			parent->removeChild(this);
 
 		parent = new_parent;
+		++hierarchyVersion;
 	}
 
 	void swap(Child &left, Child &right) {
 		std::swap(left.parent, right.parent);
+		++Child::hierarchyVersion;
 	}
 }
@@ -1,4 +1,5 @@
 #include "haunted/core/Defs.h"
+#include "haunted/core/Terminal.h"
 #include "haunted/ui/Coloration.h"
 
 namespace Haunted::UI {
@@ -6,8 +7,7 @@ namespace Haunted::UI {
 		if (foreground == lastForeground)
 			return false;
 
-		auto lock = getLock();
-		*outStream << ansi::get_fg(lastForeground = foreground);
+		*terminal << ansi::get_fg(lastForeground = foreground);
 		return true;
 	}
 
@@ -15,8 +15,7 @@ namespace Haunted::UI {
 		if (background == lastBackground)
 			return false;
 
-		auto lock = getLock();
-		*outStream << ansi::get_bg(lastBackground = background);
+		*terminal << ansi::get_bg(lastBackground = background);
 		return true;
 	}
 
@@ -26,7 +25,7 @@ namespace Haunted::UI {
 	}
 
 	void Coloration::apply() {
-		*outStream << ansi::get_fg(lastForeground) << ansi::get_bg(lastBackground);
+		*terminal << ansi::get_fg(lastForeground) << ansi::get_bg(lastBackground);
 	}
 
 	bool Coloration::reset() {
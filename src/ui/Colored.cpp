@@ -124,7 +124,9 @@ namespace Haunted::UI {
 			}
 		}
 
-		draw();
+		Terminal *term = getTerminal();
+		if (!term || !term->requestDraw(dynamic_cast<Control *>(this)))
+			draw();
 		return true;
 	}
 
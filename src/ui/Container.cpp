@@ -15,6 +15,7 @@ namespace Haunted::UI {
 
 	bool Container::addChild(Control *child) {
 		children.push_back(child);
+		++Control::layoutVersion;
 		return true;
 	}
 
@@ -22,6 +23,7 @@ namespace Haunted::UI {
 		for (auto iter = children.begin(); iter != children.end(); ++iter)
 			if (*iter == to_remove) {
 				children.erase(iter);
+				++Control::layoutVersion;
 				to_remove->setParent(nullptr);
 				return true;
 			}
@@ -34,6 +36,17 @@ namespace Haunted::UI {
 		x += pos.left;
 		y += pos.top;
 
+		if (indexThreshold <= children.size()) {
+			const uint64_t version = Control::layoutVersion.load(std::memory_order_relaxed);
+			if (indexVersion != version || indexedCount != children.size()) {
+				index.build(children);
+				indexVersion = version;
+				indexedCount = children.size();
+			}
+
+			return index.find(x, y);
+		}
+
 		for (Control *child: children) {
 			const Position &cpos = child->getPosition();
 			if ((cpos.left <= x) && (x <= cpos.right()) && (cpos.top <= y) && (y <= cpos.bottom()))
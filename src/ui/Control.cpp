@@ -7,18 +7,30 @@
 #include "lib/formicine/ansi.h"
 
 namespace Haunted::UI {
+	std::atomic<uint64_t> Control::layoutVersion {1};
+
 	Control::Control(Container *parent_, const Haunted::Position &position_):
 	Child(parent_), terminal(nullptr), position(position_) {
+		asControl = this;
 		if (parent_)
 			terminal = parent_->getTerminal();
 	}
 
 	Control::Control(Container *parent_, Terminal *terminal_):
-		Child(parent_), terminal(terminal_) {}
+	Child(parent_), terminal(terminal_) {
+		asControl = this;
+	}
 
 	Control::Control(Container *parent_):
 		Control(parent_, parent_ == nullptr? nullptr : parent_->getTerminal()) {}
 
+	Control::~Control() {
+		if (terminal) {
+			terminal->cancelDraw(this);
+			terminal->metrics.forget(this);
+		}
+	}
+
 
 // Protected instance methods
 
@@ -41,9 +53,14 @@ namespace Haunted::UI {
 // Public instance methods
 
 
+	bool Control::requestDraw() {
+		return terminal && terminal->requestDraw(this);
+	}
+
 	void Control::resize(const Haunted::Position &new_pos) {
 		// It's up to the caller of resize() to also call draw().
 		position = new_pos;
+		++layoutVersion;
 	}
 
 	std::string Control::getID(bool pad) const {
@@ -83,6 +100,7 @@ namespace Haunted::UI {
 	void Control::move(int left, int top) {
 		position.left = left;
 		position.top = top;
+		++layoutVersion;
 	}
 
 	void Control::focus() {
@@ -90,6 +108,23 @@ namespace Haunted::UI {
 			terminal->focus(this);
 	}
 
+	const std::vector<InputHandler *> & Control::bubblePath() {
+		const uint64_t version = hierarchyVersion.load(std::memory_order_relaxed);
+		if (bubblePathVersion == version)
+			return bubblePathCache;
+
+		bubblePathCache.clear();
+		bubblePathCache.push_back(this);
+		for (Container *container = parent; container != nullptr;) {
+			bubblePathCache.push_back(container);
+			Control *control = container->toControl();
+			container = control? control->getParent() : nullptr;
+		}
+
+		bubblePathVersion = version;
+		return bubblePathCache;
+	}
+
 	void Control::setParent(Container *parent_) {
 		Child::setParent(parent_);
 		if (parent_ != nullptr) {
@@ -99,7 +134,8 @@ namespace Haunted::UI {
 	}
 
 	void Control::jump() {
-		position.jump();
+		if (terminal)
+			terminal->jump(position.left, position.top);
 	}
 
 	void Control::jumpFocus() {
@@ -115,29 +151,9 @@ namespace Haunted::UI {
 				// Galaxy brain trickery here. If this control is as wide as the entire terminal, we can vscroll the
 				// contents into oblivion very efficiently.
 				terminal->vscroll(position.height);
-			} else if (atLeft()) {
-				// If we're at the left, we can clear each line from the end of the line to the left edge of the screen.
-				terminal->jump(position.width - 1, 0);
-				for (int i = 0; i < position.height; ++i) {
-					if (i)
-						terminal->down();
-					terminal->clearLeft();
-				}
-			} else if (atRight()) {
-				// If we're at the right, we can clear each line from the start of the line to the right edge.
-				terminal->jump(position.left, 0);
-				for (int i = 0; i < position.height; ++i) {
-					if (i)
-						terminal->down();
-					terminal->clearRight();
-				}
 			} else {
-				// If we're at neither edge, we have to print a total of width*height spaces. Very sad.
-				std::string spaces(static_cast<size_t>(position.width), ' ');
-				for (int i = 0; i < position.height; ++i) {
-					terminal->jump(position.left, i);
-					*terminal << spaces;
-				}
+				// Otherwise, the terminal picks whichever erasing sequences are cheapest for the control's position.
+				terminal->clearRect(0, 0, position.width, position.height);
 			}
 		});
 	}
@@ -161,9 +177,7 @@ namespace Haunted::UI {
 
 	void Control::setMargins() {
 		if (terminal != nullptr) {
-			terminal->enableHmargins();
-			terminal->margins(position.top, position.bottom(), position.left, position.right());
-			terminal->setOrigin();
+			terminal->claimMargins(position.top, position.bottom(), position.left, position.right());
 			inMargins = true;
 		}
 	}
@@ -178,9 +192,7 @@ namespace Haunted::UI {
 
 	void Control::resetMargins() {
 		if (terminal != nullptr) {
-			terminal->resetOrigin();
-			terminal->margins();
-			terminal->disableHmargins();
+			terminal->releaseMargins();
 			inMargins = false;
 		}
 	}
@@ -6,7 +6,17 @@ namespace Haunted::UI {
 		return keyFunction? keyFunction(k) : false;
 	}
 
+	bool InputHandler::handleKey(const Key &k) {
+		if (keymap && keymap->feed(k) != Keymap::Match::None)
+			return true;
+		return onKey(k);
+	}
+
 	bool InputHandler::onMouse(const MouseReport &m) {
 		return mouseFunction? mouseFunction(m) : false;
 	}
+
+	bool InputHandler::onPaste(const std::string &text) {
+		return pasteFunction? pasteFunction(text) : false;
+	}
 }
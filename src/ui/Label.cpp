@@ -20,7 +20,8 @@ namespace Haunted::UI {
 	void Label::setText(const std::string &text_) {
 		if (text != text_) {
 			text = text_;
-			draw();
+			if (!requestDraw())
+				draw();
 		}
 	}
 
@@ -35,6 +36,8 @@ namespace Haunted::UI {
 			return;
 
 		auto lock = terminal->lockRender();
+		auto timer = terminal->metrics.timeDraw(this);
+		Terminal::Frame frame(terminal);
 		Colored::draw();
 		jump();
 
@@ -55,7 +58,6 @@ namespace Haunted::UI {
 		}
 
 		terminal->resetColors();
-		terminal->flush();
 		terminal->jumpToFocused();
 	}
 
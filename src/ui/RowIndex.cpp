@@ -0,0 +1,96 @@
+#include "haunted/ui/RowIndex.h"
+
+namespace Haunted::UI {
+	static inline size_t lowbit(size_t i) {
+		return i & -i;
+	}
+
+
+// Private instance methods
+
+
+	size_t RowIndex::sum(size_t end) const {
+		size_t out = 0;
+		for (; 0 < end; end -= lowbit(end))
+			out += tree[end];
+		return out;
+	}
+
+	void RowIndex::add(size_t slot, ptrdiff_t delta) {
+		for (size_t i = slot + 1; i < tree.size(); i += lowbit(i))
+			tree[i] += delta;
+		totalRows += delta;
+	}
+
+	void RowIndex::compact() {
+		counts.erase(counts.begin(), counts.begin() + removed);
+		removed = 0;
+
+		tree.assign(counts.size() + 1, 0);
+		for (size_t i = 1; i < tree.size(); ++i) {
+			tree[i] += counts[i - 1];
+			if (const size_t parent = i + lowbit(i); parent < tree.size())
+				tree[parent] += tree[i];
+		}
+	}
+
+
+// Public instance methods
+
+
+	void RowIndex::clear() {
+		tree.assign(1, 0);
+		counts.clear();
+		removed = 0;
+		totalRows = 0;
+	}
+
+	void RowIndex::reserve(size_t lines) {
+		tree.reserve(lines + 1);
+		counts.reserve(lines);
+	}
+
+	void RowIndex::pushBack(size_t rows) {
+		// The new node covers the slots from i - lowbit(i) up to and including itself.
+		const size_t i = tree.size();
+		tree.push_back(rows + sum(i - 1) - sum(i - lowbit(i)));
+		counts.push_back(rows);
+		totalRows += rows;
+	}
+
+	void RowIndex::popFront(size_t count) {
+		for (; 0 < count && removed < counts.size(); --count) {
+			add(removed, -ptrdiff_t(counts[removed]));
+			counts[removed++] = 0;
+		}
+
+		if (counts.size() < removed * 2)
+			compact();
+	}
+
+	void RowIndex::set(size_t index, size_t rows) {
+		size_t &count = counts[removed + index];
+		if (count != rows) {
+			add(removed + index, ptrdiff_t(rows) - ptrdiff_t(count));
+			count = rows;
+		}
+	}
+
+	std::pair<size_t, size_t> RowIndex::find(size_t row) const {
+		size_t step = 1;
+		while (step * 2 < tree.size())
+			step *= 2;
+
+		// Descend the tree to the last slot whose prefix sum doesn't exceed the row. Slots with zero rows are skipped
+		// because the comparison allows equality.
+		size_t slot = 0;
+		for (; 0 < step; step /= 2) {
+			if (slot + step < tree.size() && tree[slot + step] <= row) {
+				slot += step;
+				row -= tree[slot];
+			}
+		}
+
+		return {slot - removed, row};
+	}
+}
@@ -0,0 +1,78 @@
+#include <algorithm>
+
+#include "haunted/ui/Control.h"
+#include "haunted/ui/SpatialIndex.h"
+
+namespace Haunted::UI {
+	void SpatialIndex::build(const std::deque<Control *> &controls) {
+		bands.clear();
+
+		std::vector<std::pair<Control *, Position>> entries;
+		entries.reserve(controls.size());
+		for (Control *control: controls)
+			entries.emplace_back(control, control->getPosition());
+
+		// Every top edge and every row just below a bottom edge starts a new band.
+		std::vector<ssize_t> edges;
+		edges.reserve(entries.size() * 2);
+		for (const auto &[control, pos]: entries) {
+			if (0 < pos.width && 0 < pos.height) {
+				edges.push_back(pos.top);
+				edges.push_back(pos.top + pos.height);
+			}
+		}
+
+		std::sort(edges.begin(), edges.end());
+		edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+		bands.reserve(edges.size());
+		for (const ssize_t edge: edges)
+			bands.push_back({edge, {}});
+
+		for (size_t order = 0; order < entries.size(); ++order) {
+			const auto &[control, pos] = entries[order];
+			if (pos.width <= 0 || pos.height <= 0)
+				continue;
+
+			auto band = std::lower_bound(bands.begin(), bands.end(), pos.top,
+				[](const Band &band, ssize_t top) { return band.top < top; });
+			for (; band != bands.end() && band->top < pos.top + pos.height; ++band)
+				band->spans.push_back({pos.left, pos.right(), order, control});
+		}
+
+		for (Band &band: bands) {
+			std::sort(band.spans.begin(), band.spans.end(), [](const Span &left, const Span &right) {
+				return left.left < right.left || (left.left == right.left && left.order < right.order);
+			});
+
+			for (size_t i = 1; i < band.spans.size() && !band.overlapping; ++i)
+				band.overlapping = band.spans[i].left <= band.spans[i - 1].right;
+
+			if (band.overlapping)
+				std::sort(band.spans.begin(), band.spans.end(),
+					[](const Span &left, const Span &right) { return left.order < right.order; });
+		}
+	}
+
+	Control * SpatialIndex::find(ssize_t x, ssize_t y) const {
+		// Find the last band that starts at or above the row.
+		auto band = std::upper_bound(bands.begin(), bands.end(), y,
+			[](ssize_t row, const Band &band) { return row < band.top; });
+		if (band == bands.begin())
+			return nullptr;
+		--band;
+
+		if (band->overlapping) {
+			for (const Span &span: band->spans)
+				if (span.left <= x && x <= span.right)
+					return span.control;
+			return nullptr;
+		}
+
+		auto span = std::upper_bound(band->spans.begin(), band->spans.end(), x,
+			[](ssize_t column, const Span &span) { return column < span.left; });
+		if (span == band->spans.begin())
+			return nullptr;
+		--span;
+		return x <= span->right? span->control : nullptr;
+	}
+}
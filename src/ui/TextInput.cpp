@@ -40,7 +40,7 @@ namespace Haunted::UI {
 	}
 
 	void TextInput::drawInsert(size_t count) {
-		if (!canDraw())
+		if (!canDraw() || requestDraw())
 			return;
 
 
@@ -64,9 +64,9 @@ namespace Haunted::UI {
 
 		auto lock = terminal->lockRender();
 		tryColors();
-		terminal->outStream.save();
+		terminal->save();
 		jumpCursor();
-		terminal->outStream.left();
+		terminal->left();
 		// Point cpos = findCursor();
 		// Print only enough text to reach the right edge. Printing more would cause wrapping or text being printed out
 		// of bounds.
@@ -79,7 +79,7 @@ namespace Haunted::UI {
 		// DBG("}}");
 
 		printGraphemes(buffer.substr(cur));
-		terminal->outStream.restore();
+		terminal->restore();
 		terminal->colors.apply();
 		if (hasFocus())
 			jumpCursor();
@@ -100,16 +100,11 @@ namespace Haunted::UI {
 		if (!canDraw())
 			return;
 
-		terminal->jump(prefixLength + offset, position.top);
 		applyColors();
-		if (position.right() == terminal->getPosition().right()) {
-			// If the TextInput stretches to the right edge of the terminal, we can use clearRight.
-			terminal->outStream.clear_right();
-		} else {
-			// Horizontal margins don't work everywhere, and clearRight doesn't respect them anyway, so we have to use
-			// this unsavory hack to clear just part of the screen.
-			*terminal << std::string(position.width - (prefixLength + offset), ' ');
-		}
+		// Horizontal margins don't work everywhere and clearRight doesn't respect them anyway, so the terminal has to
+		// decide how to clear just part of the line. It only uses EL if the input ends at the right edge.
+		const int x = position.left + prefixLength + offset;
+		terminal->clearRect(x, position.top, position.left + position.width - x, 1);
 	}
 
 	Point TextInput::findCursor() const {
@@ -302,10 +297,10 @@ namespace Haunted::UI {
 					// If there's no text after the cursor and the cursor is in bounds,
 					// it should be sufficient to erase the old character from the screen.
 					applyColors();
-					terminal->outStream.save();
+					terminal->save();
 					jumpCursor();
 					*terminal << ' ';
-					terminal->outStream.restore();
+					terminal->restore();
 				} else {
 					// Otherwise, we need drawErase() to handle things.
 					drawErase();
@@ -580,13 +575,40 @@ namespace Haunted::UI {
 		return true;
 	}
 
+	bool TextInput::onPaste(const std::string &text) {
+		std::string filtered;
+		filtered.reserve(text.size());
+		for (const unsigned char ch: text)
+			if (0x20 <= ch || whitelist.find(ch) != whitelist.end())
+				filtered += ch;
+
+		if (filtered.empty())
+			return true;
+
+		const size_t old_length = buffer.length();
+		buffer.insert(cursor, filtered);
+		cursor += buffer.length() - old_length;
+
+		// Unlike a single insertion, a paste can move the cursor more than one column past the right edge.
+		if (scroll + textWidth() < cursor)
+			scroll = cursor - textWidth();
+
+		draw();
+		drawCursor();
+		flush();
+		update();
+		return true;
+	}
+
 	void TextInput::draw() {
 		if (!canDraw())
 			return;
 
+		auto lock = terminal->lockRender();
+		auto timer = terminal->metrics.timeDraw(this);
+		Terminal::Frame frame(terminal);
 		Colored::draw();
 
-		auto lock = terminal->lockRender();
 		size_t twidth = textWidth();
 
 		clearLine();
@@ -616,7 +638,7 @@ namespace Haunted::UI {
 
 		auto lock = terminal->lockRender();
 		applyColors();
-		terminal->outStream.save();
+		terminal->save();
 		clearLine();
 		const size_t old_cursor = cursor;
 		cursor = offset < 0 && -offset > ssize_t(cursor)? 0 : cursor + offset;
@@ -627,7 +649,7 @@ namespace Haunted::UI {
 		// *terminal << buffer.substr(cursor, twidth - cursor + scroll);
 		printGraphemes(buffer.substr(cursor));
 		cursor = old_cursor;
-		terminal->outStream.restore();
+		terminal->restore();
 	}
 
 	void TextInput::drawErase() {
@@ -638,7 +660,7 @@ namespace Haunted::UI {
 
 		auto lock = terminal->lockRender();
 		applyColors();
-		terminal->outStream.save();
+		terminal->save();
 
 		if (cursor <= scroll) {
 			// If the cursor is at or beyond the left edge, redraw the entire line.
@@ -656,7 +678,7 @@ namespace Haunted::UI {
 			printGraphemes(buffer.substr(cursor));
 		}
 
-		terminal->outStream.restore();
+		terminal->restore();
 		flush();
 	}
 
@@ -694,9 +716,10 @@ namespace Haunted::UI {
 			if (width == 1) {
 				*terminal << grapheme;
 			} else {
-				terminal->outStream.save();
+				terminal->save();
 				*terminal << grapheme;
-				terminal->outStream.restore().right(width);
+				terminal->restore();
+				terminal->right(width);
 			}
 #endif
 		}
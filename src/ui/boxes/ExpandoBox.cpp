@@ -130,6 +130,7 @@ namespace Haunted::UI::Boxes {
 		Colored::draw();
 
 		auto lock = terminal->lockRender();
+		auto timer = terminal->metrics.timeDraw(this);
 		for (Control *child: children)
 			child->draw();
 	}
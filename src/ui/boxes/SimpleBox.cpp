@@ -17,6 +17,7 @@ namespace Haunted::UI::Boxes {
 	void SimpleBox::draw() {
 		if (canDraw() && !children.empty()) {
 			auto lock = terminal->lockRender();
+			auto timer = terminal->metrics.timeDraw(this);
 			children.at(0)->draw();
 		}
 	}
@@ -70,6 +70,8 @@ namespace Haunted::UI::Boxes {
 		if (!canDraw())
 			return;
 
+		auto timer = terminal->metrics.timeDraw(this);
+
 		if (active)
 			active->draw();
 		else